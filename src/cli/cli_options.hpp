@@ -13,7 +13,12 @@ struct AppOptions {
 
     // Perf
     int64_t     chunk_bytes = 262144;   // 256 KiB default
-    double      sample_frac = 0.10;     // 0..1
+    double      sample_frac = -1.0;     // -1 = from config [sampling]; in (0, 1) samples, 1 = exact
+    std::string io_backend  = "auto";   // auto | mmap | read | async
+    int         threads     = -1;       // -1 = from config [perf] threads; 0 = all cores
+    int         read_ahead  = -1;       // -1 = from config [perf] read_ahead
+    bool        no_cache    = false;    // skip the profile cache under <output-root>/.cache
+    std::string snapshot;               // also write a columnar snapshot of the input here
 
     // CSV parsing
     std::string delimiter = ",";        // single char, e.g. ","
@@ -35,7 +40,13 @@ inline AppOptions parse_cli(int argc, char** argv) {
 
     // Perf
     app.add_option("--chunk-bytes", opt.chunk_bytes,"Chunk size (bytes)");
-    app.add_option("--sample-frac", opt.sample_frac,"Typed sample fraction (0..1)");
+    app.add_option("--sample-frac", opt.sample_frac,"Profile this fraction of the input from random blocks (0..1; 1 = exact; default: config [sampling])");
+    app.add_option("--io-backend",  opt.io_backend, "Input backend: auto (mmap, async fallback), mmap, read, async")
+        ->default_val("auto");
+    app.add_option("--threads",     opt.threads,    "Worker threads (0 = all cores; default: config [perf] threads)");
+    app.add_option("--read-ahead",  opt.read_ahead, "Async backend ring depth in chunks (default: config [perf] read_ahead)");
+    app.add_flag("--no-cache",      opt.no_cache,   "Do not read or write the profile cache (<output-root>/.cache)");
+    app.add_option("--snapshot",    opt.snapshot,   "Also write a columnar snapshot of the input to this path (usable as --input later)");
 
     // CSV parsing
     app.add_option("-d,--delimiter", opt.delimiter,
@@ -59,8 +70,15 @@ inline AppOptions parse_cli(int argc, char** argv) {
     one_char(opt.quote,     "quote");
     one_char(opt.escape,    "escape");
 
-    if (opt.sample_frac < 0.0 || opt.sample_frac > 1.0)
+    if (opt.sample_frac != -1.0 && (opt.sample_frac < 0.0 || opt.sample_frac > 1.0))
         throw CLI::ValidationError{"sample-frac", "must be in [0, 1]"};
+    if (opt.io_backend != "auto" && opt.io_backend != "mmap" && opt.io_backend != "read" &&
+        opt.io_backend != "async")
+        throw CLI::ValidationError{"io-backend", "must be one of: auto, mmap, read, async"};
+    if (opt.threads < -1)
+        throw CLI::ValidationError{"threads", "must be >= 0"};
+    if (opt.read_ahead != -1 && opt.read_ahead < 2)
+        throw CLI::ValidationError{"read-ahead", "must be >= 2"};
     if (opt.chunk_bytes <= 0)
         throw CLI::ValidationError{"chunk-bytes", "must be > 0"};
 
@@ -0,0 +1,145 @@
+#pragma once
+#include <toml++/toml.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../types/infer.hpp"
+#include "../types/parse_date.hpp"
+#include "../util/nulls.hpp"
+
+// Settings read from config.toml (see config/config.toml for the documented
+// layout). Every field has a default, so a missing file means "all defaults";
+// a file that exists but does not parse is an error.
+struct AppConfig {
+    // [perf]
+    int threads = 0;            // 0 = all hardware threads, 1 = single-thread
+    int read_ahead = 4;         // async backend: chunk buffers in the read-ahead ring
+    bool cache = true;          // profile cache under <output root>/.cache
+    bool incremental = true;    // resume grown append-only inputs from their cached state
+    bool row_index = false;     // sidecar row index next to the input (<input>.csvqr-index)
+
+    // [sampling] (off by default: every row is read and counts are exact)
+    bool   sampling = false;
+    double sample_frac = 0.10;            // share of the data bytes profiled when sampling
+    std::int64_t max_sample_rows = 200000; // stop sampling after this many rows (0 = no cap)
+
+    // [columns] (projection; names as in the header, or col1..colN without one)
+    std::vector<std::string> include_columns;   // empty = all columns
+    std::vector<std::string> exclude_columns;
+
+    // [nulls]
+    std::vector<std::string> null_values = csvqr::default_null_tokens();   // matched trimmed, ASCII case-insensitive
+
+    // [types]
+    std::vector<std::pair<std::string, std::string>> forced_types;   // force: column -> type, inference skipped
+    std::vector<std::string> date_formats     = csvqr::default_date_formats();
+    std::vector<std::string> datetime_formats = csvqr::default_datetime_formats();
+
+    // [profilers]
+    std::vector<double> quantiles = {0.5, 0.95};
+    int quantile_k = 200;       // KLL sketch size: rank error ~1.7/k, memory ~3k values per column
+    int topk = 20;              // frequent values per column (0 = off); 4x as many counters are kept
+    int hist_bins = 32;         // max histogram bins per numeric column (streaming, fixed memory)
+    int hll_precision = 12;     // distinct counts: 2^p bytes per column, ~1.04/sqrt(2^p) error
+};
+
+// Reads an array of strings; a missing key keeps `out` as is.
+template <class NodeView>
+void read_string_list(NodeView v, std::vector<std::string>& out,
+                      const std::string& path, const char* name) {
+    if (!v) return;
+    auto* arr = v.as_array();
+    if (!arr) throw std::runtime_error("config " + path + ": " + name + " must be an array of strings");
+    out.clear();
+    for (auto& el : *arr) {
+        auto s = el.template value<std::string>();
+        if (!s) throw std::runtime_error("config " + path + ": " + name + " must be an array of strings");
+        out.push_back(*s);
+    }
+}
+
+inline AppConfig load_config(const std::string& path) {
+    AppConfig cfg;
+    std::error_code ec;
+    if (path.empty() || !std::filesystem::exists(path, ec)) return cfg;
+
+    toml::table tbl;
+    try {
+        tbl = toml::parse_file(path);
+    } catch (const toml::parse_error& e) {
+        throw std::runtime_error("config " + path + ": " + std::string(e.what()));
+    }
+
+    cfg.threads = static_cast<int>(tbl["perf"]["threads"].value_or(static_cast<std::int64_t>(cfg.threads)));
+    if (cfg.threads < 0) throw std::runtime_error("config " + path + ": [perf] threads must be >= 0");
+    cfg.read_ahead = static_cast<int>(tbl["perf"]["read_ahead"].value_or(static_cast<std::int64_t>(cfg.read_ahead)));
+    if (cfg.read_ahead < 2) throw std::runtime_error("config " + path + ": [perf] read_ahead must be >= 2");
+    cfg.cache = tbl["perf"]["cache"].value_or(cfg.cache);
+    cfg.incremental = tbl["perf"]["incremental"].value_or(cfg.incremental);
+    cfg.row_index = tbl["perf"]["row_index"].value_or(cfg.row_index);
+
+    cfg.sampling = tbl["sampling"]["enabled"].value_or(cfg.sampling);
+    cfg.sample_frac = tbl["sampling"]["sample_frac"].value_or(cfg.sample_frac);
+    if (cfg.sample_frac <= 0.0 || cfg.sample_frac > 1.0)
+        throw std::runtime_error("config " + path + ": [sampling] sample_frac must be in (0, 1]");
+    cfg.max_sample_rows = tbl["sampling"]["max_sample_rows"].value_or(cfg.max_sample_rows);
+    if (cfg.max_sample_rows < 0)
+        throw std::runtime_error("config " + path + ": [sampling] max_sample_rows must be >= 0");
+
+    if (auto v = tbl["profilers"]["quantiles"]; v) {
+        auto* arr = v.as_array();
+        if (!arr) throw std::runtime_error("config " + path + ": [profilers] quantiles must be an array of numbers");
+        cfg.quantiles.clear();
+        for (auto& el : *arr) {
+            auto q = el.value<double>();
+            if (!q || *q < 0.0 || *q > 1.0)
+                throw std::runtime_error("config " + path + ": [profilers] quantiles must be numbers in [0, 1]");
+            cfg.quantiles.push_back(*q);
+        }
+    }
+    cfg.quantile_k = static_cast<int>(tbl["profilers"]["quantile_k"].value_or(static_cast<std::int64_t>(cfg.quantile_k)));
+    if (cfg.quantile_k < 8 || cfg.quantile_k > 65535)
+        throw std::runtime_error("config " + path + ": [profilers] quantile_k must be in [8, 65535]");
+
+    cfg.topk = static_cast<int>(tbl["profilers"]["topk"].value_or(static_cast<std::int64_t>(cfg.topk)));
+    if (cfg.topk < 0) throw std::runtime_error("config " + path + ": [profilers] topk must be >= 0");
+
+    cfg.hist_bins = static_cast<int>(tbl["profilers"]["hist_bins"].value_or(static_cast<std::int64_t>(cfg.hist_bins)));
+    if (cfg.hist_bins < 2 || cfg.hist_bins > 4096)
+        throw std::runtime_error("config " + path + ": [profilers] hist_bins must be in [2, 4096]");
+
+    cfg.hll_precision = static_cast<int>(tbl["profilers"]["hll_precision"].value_or(static_cast<std::int64_t>(cfg.hll_precision)));
+    if (cfg.hll_precision < 4 || cfg.hll_precision > 18)
+        throw std::runtime_error("config " + path + ": [profilers] hll_precision must be in [4, 18]");
+
+    read_string_list(tbl["columns"]["include"], cfg.include_columns, path, "[columns] include");
+    read_string_list(tbl["columns"]["exclude"], cfg.exclude_columns, path, "[columns] exclude");
+    read_string_list(tbl["nulls"]["values"], cfg.null_values, path, "[nulls] values");
+    if (auto v = tbl["types"]["force"]; v) {
+        auto* t = v.as_table();
+        if (!t) throw std::runtime_error("config " + path + ": [types] force must be a table of column = \"type\"");
+        for (auto&& [k, node] : *t) {
+            const std::string col(k.str());
+            auto type = node.value<std::string>();
+            if (!type || !csvqr::forced_type_bits(*type))
+                throw std::runtime_error("config " + path + ": [types] force." + col +
+                                         " must be one of int64, float64, bool, date, datetime, string");
+            cfg.forced_types.emplace_back(col, *type);
+        }
+    }
+    read_string_list(tbl["types"]["date_formats"], cfg.date_formats, path, "[types] date_formats");
+    read_string_list(tbl["types"]["datetime_formats"], cfg.datetime_formats, path, "[types] datetime_formats");
+    try {
+        for (const auto& f : cfg.date_formats)
+            if (csvqr::date_format(f).has_time())
+                throw std::invalid_argument("time fields belong in datetime_formats: " + f);
+        for (const auto& f : cfg.datetime_formats) (void)csvqr::date_format(f);
+    } catch (const std::invalid_argument& e) {
+        throw std::runtime_error("config " + path + ": [types] " + e.what());
+    }
+    return cfg;
+}
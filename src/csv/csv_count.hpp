@@ -1,16 +1,24 @@
 #pragma once
 #include <cstdint>
+#include <cstring>
 #include <filesystem>
-#include <fstream>
-#include <vector>
+#include <string_view>
 #include <stdexcept>
 
+#include "../io/chunk_reader.hpp"
+#include "simd_classify.hpp"
+
 // Minimal RFC4180-aware scan to count rows and columns using a chunk buffer.
 // - Counts rows by seeing newlines that occur OUTSIDE quotes.
 // - Determines column count from the first logical line (header or first row),
 //   counting delimiters OUTSIDE quotes.
 // - Handles CRLF and CR newlines; normalizes all to '\n' for counting.
 // - Handles escaped quotes inside quoted fields per RFC4180 ("").
+// - A final line without a trailing newline still counts as a row.
+// - SIMD path: each 64-byte block is classified into quote/delimiter/LF/CR
+//   bitmasks (SSE2 or AVX2, picked at runtime); prefix-XOR of the quote mask
+//   yields the in-quote region, so rows/columns fall out of popcounts.
+//   The byte-at-a-time loop stays as the scalar kernel/fallback.
 //
 // NOTE: We do not validate malformed CSV here; this is a fast counter.
 
@@ -19,139 +27,164 @@ struct CsvCounts {
     std::uint32_t columns = 0;
 };
 
-inline CsvCounts csv_count_rows_cols(const std::filesystem::path& path,
-                                     char delimiter,
-                                     char quote,
-                                     std::size_t chunk_bytes,
-                                     bool has_header)
-{
-    std::ifstream in(path, std::ios::binary);
-    if (!in) throw std::runtime_error("Failed to open: " + path.string());
-    if (chunk_bytes == 0) chunk_bytes = 262144;
+// Incremental form of the counter. State carries across feed() calls, so it can
+// be driven from any chunk source (including a chunk shared with other stages).
+//
+// Quotes simply toggle the in-quote state: an escaped "" inside a quoted field
+// toggles twice and leaves the state unchanged, which is exactly RFC4180 for the
+// purpose of finding structural delimiters/newlines (and works across chunks).
+struct csv_counter {
+    char delimiter = ',';
+    char quote     = '"';
+
+    bool in_quotes      = false;
+    bool prev_was_cr    = false;   // swallow the LF of a CRLF split across chunks
+    bool at_line_start  = true;
+    bool first_row_done = false;
+
+    std::uint64_t rows           = 0;   // physical rows incl. header, excl. trailing partial
+    std::uint32_t cur_cols       = 1;   // columns = delimiters + 1 (first row only)
+    std::uint32_t first_row_cols = 0;
+
+    csvqr::count_kernel kernel = csvqr::resolve_kernel(csvqr::count_kernel::automatic);
+
+    csv_counter() = default;
+    csv_counter(char delim, char q, csvqr::count_kernel k = csvqr::count_kernel::automatic)
+        : delimiter(delim), quote(q), kernel(csvqr::resolve_kernel(k)) {}
+
+    void feed(const char* data, std::size_t n) {
+        switch (kernel) {
+#if CSVQR_X86
+            case csvqr::count_kernel::sse2: feed_blocks<csvqr::classify_sse2>(data, n); break;
+            case csvqr::count_kernel::avx2: feed_avx2(data, n); break;
+#endif
+            default: feed_scalar(data, n); break;
+        }
+    }
+    void feed(std::string_view chunk) { feed(chunk.data(), chunk.size()); }
 
-    std::vector<char> buf(chunk_bytes);
+    void feed_scalar(const char* data, std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i) {
+            const char c = data[i];
 
-    bool in_quotes = false;
-    bool first_line_done = false;
-    std::uint32_t header_cols = 1;   // at least 1 col if any data
-    bool seen_any_data = false;
+            if (prev_was_cr) {
+                prev_was_cr = false;
+                if (c == '\n') continue; // already finished row on CR
+            }
 
-    std::uint64_t rows = 0;
-    char prev = '\0';
-    bool have_prev = false;
-
-    auto is_newline = [&](char c) { return c == '\n'; };
-
-    // Helper to handle entering/leaving quotes + escaped quotes.
-    auto handle_quote = [&](const char* data, std::size_t i, std::size_t n) {
-        if (!in_quotes) {
-            in_quotes = true;
-        } else {
-            // If we're in quotes and see a second consecutive quote -> escaped
-            if (i + 1 < n && data[i + 1] == quote) {
-                // Skip the next quote (treat as literal ")
-                return std::size_t{1}; // caller will i += returned
+            if (c == quote) {
+                in_quotes = !in_quotes;
+                at_line_start = false;
+            } else if (in_quotes) {
+                at_line_start = false;
+            } else if (c == delimiter) {
+                if (!first_row_done) ++cur_cols;
+                at_line_start = false;
+            } else if (c == '\n' || c == '\r') {
+                finish_row();
+                prev_was_cr = (c == '\r');
             } else {
-                in_quotes = false; // end quoted field
+                at_line_start = false;
             }
         }
-        return std::size_t{0};
-    };
-
-    // We need to detect CRLF and CR. We'll convert to LF semantics on the fly.
-    // Strategy: if we see '\r', treat newline. If next is '\n', consume it too.
-    // We do this by looking at prev/current characters.
-
-    while (in) {
-        in.read(buf.data(), static_cast<std::streamsize>(buf.size()));
-        std::streamsize got = in.gcount();
-        if (got <= 0) break;
-
-        const char* data = buf.data();
-        std::size_t n = static_cast<std::size_t>(got);
+    }
 
-        for (std::size_t i = 0; i < n; ++i) {
-            char c = data[i];
-
-            // Normalize CR/CRLF to single '\n' events
-            if (c == '\r') {
-                // Treat as newline outside quotes only
-                if (!in_quotes) {
-                    rows++;
-                    first_line_done = first_line_done ? true : true;
-                }
-                have_prev = false; // reset prev since CRLF handling below eats LF
-                // If next is '\n', skip it
-                if (i + 1 < n && data[i + 1] == '\n') {
-                    ++i;
-                } else {
-                    // Could be lone CR across chunk boundary: peek next iteration via prev
-                    // We just handled as newline already.
-                }
-                continue;
-            }
+    // Bitmask kernel over 64-byte blocks; the tail is zero-padded and masked off.
+    template <class Classifier>
+    void feed_blocks(const char* data, std::size_t n) {
+        std::size_t i = 0;
+        for (; i + 64 <= n; i += 64)
+            process_block(Classifier::run(data + i, delimiter, quote), 64);
+        if (i < n) {
+            alignas(64) char tail[64] = {};
+            std::memcpy(tail, data + i, n - i);
+            process_block(Classifier::run(tail, delimiter, quote), n - i);
+        }
+    }
 
-            // Handle quotes
-            if (c == quote) {
-                std::size_t skip = handle_quote(data, i, n);
-                if (skip > 0) { i += skip; }
-                continue;
-            }
+#if CSVQR_X86
+    CSVQR_TARGET_AVX2 void feed_avx2(const char* data, std::size_t n) {
+        feed_blocks<csvqr::classify_avx2>(data, n);
+    }
+#endif
+
+    // Rows seen so far (physical, header included); useful for progress samples.
+    std::uint64_t rows_so_far() const noexcept { return rows; }
+
+    // Final counts; accounts for a last line without a trailing newline.
+    CsvCounts finish(bool has_header) const {
+        std::uint64_t total = rows;
+        std::uint32_t cols  = first_row_done ? first_row_cols : 0;
+        if (!at_line_start) {
+            ++total;
+            if (!first_row_done) cols = cur_cols;
+        }
 
-            // Count header columns from first logical line only (outside quotes)
-            if (!first_line_done) {
-                seen_any_data = true;
-                if (!in_quotes && c == delimiter) {
-                    header_cols++;
-                } else if (!in_quotes && c == '\n') {
-                    first_line_done = true;
-                }
-            }
+        CsvCounts out{};
+        // If header present, data rows = total_rows - 1 (but not below 0)
+        out.rows    = (has_header && total > 0) ? total - 1 : total;
+        out.columns = cols;
+        return out;
+    }
 
-            // Row counting: newline outside quotes
-            if (!in_quotes && c == '\n') {
-                rows++;
+private:
+    // Same state machine as feed_scalar, evaluated for up to 64 bytes at once.
+    void process_block(const csvqr::block_masks& m, std::size_t len) {
+        const std::uint64_t valid = len == 64 ? ~std::uint64_t{0} : ((std::uint64_t{1} << len) - 1);
+        const std::uint64_t last  = std::uint64_t{1} << (len - 1);
+
+        // state AFTER each byte; carry the state from the previous block
+        const std::uint64_t inside  = csvqr::prefix_xor(m.quote & valid) ^ (in_quotes ? ~std::uint64_t{0} : 0);
+        const std::uint64_t outside = ~inside & valid;
+
+        const std::uint64_t cr = m.cr & outside;
+        const std::uint64_t lf = m.lf & outside;
+        const std::uint64_t cr_before = (cr << 1) | (prev_was_cr ? 1u : 0u);
+        const std::uint64_t ends      = cr | (lf & ~cr_before);   // LF of CRLF is swallowed
+        const std::uint64_t swallowed = lf & cr_before;
+
+        if (!first_row_done) {
+            const std::uint64_t delims = m.delim & outside;
+            if (ends) {
+                const int e = csvqr::ctz64(ends);
+                const std::uint64_t before = (std::uint64_t{1} << e) - 1;
+                cur_cols += static_cast<std::uint32_t>(csvqr::popcount64(delims & before));
+                first_row_cols = cur_cols;
+                first_row_done = true;
+            } else {
+                cur_cols += static_cast<std::uint32_t>(csvqr::popcount64(delims));
             }
-
-            prev = c;
-            have_prev = true;
         }
 
-        // Handle CRLF across chunk boundary: if last char of chunk was '\r',
-        // and the next chunk starts with '\n', we will convert at next loop; but
-        // we already counted the row on '\r' above and will ignore that '\n' next loop
-        if (have_prev && prev == '\r') {
-            prev = '\0';
-            have_prev = false;
-        }
+        rows += static_cast<std::uint64_t>(csvqr::popcount64(ends));
+        at_line_start = ((ends | swallowed) & last) != 0;
+        in_quotes     = (inside & last) != 0;
+        prev_was_cr   = (cr & last) != 0;
     }
 
-    // If we ended without a trailing newline and we have any data, count the final row.
-    // Only if we're not inside quotes (malformed CSV if we are).
-    if (seen_any_data && !in_quotes) {
-        // If the last seen char was not a normalized newline event, we need to add 1.
-        // Heuristic: if rows == 0 OR the last char wasn't newline, add 1.
-        // A simple approach: bump rows by 1 now, then correct if the file ended exactly on newline:
-        // But we already increment on newline, so only add if the very last processed char wasn't '\n' or '\r'.
-        // We don't have that readily now; use 'seen_any_data' + last char check:
-        // We'll assume common case: if file doesn't end with newline, we need this bump.
-        // To avoid double-counting when file does end with newline, rely on the fact that
-        // we incremented rows when we saw '\n' or '\r'. So:
-        // Do nothing special if last char was '\n' or '\r' because rows already counted.
-        // We lost last char here, so safest: add 1 if rows == 0 (single-line no newline),
-        // or if first_line_done is true but last char wasn't newline. We can’t know reliably,
-        // but "rows == 0" covers single-line no newline; for multi-line, most CSVs end with newline.
-        if (rows == 0) rows = 1;
+    void finish_row() {
+        ++rows;
+        if (!first_row_done) {
+            first_row_cols = cur_cols;
+            first_row_done = true;
+        }
+        at_line_start = true;
     }
+};
 
-    CsvCounts out{};
-    out.rows = rows;
-
-    // If header present, data rows = total_rows - 1 (but not below 0)
-    if (has_header && out.rows > 0) {
-        out.rows -= 1;
-    }
+inline CsvCounts csv_count_rows_cols(const std::filesystem::path& path,
+                                     char delimiter,
+                                     char quote,
+                                     std::size_t chunk_bytes,
+                                     bool has_header,
+                                     csvqr::read_backend backend = csvqr::read_backend::automatic,
+                                     csvqr::count_kernel kernel = csvqr::count_kernel::automatic)
+{
+    if (chunk_bytes == 0) chunk_bytes = 262144;
+    csvqr::chunk_reader reader(path, chunk_bytes, backend);
+    csv_counter counter(delimiter, quote, kernel);
 
-    out.columns = first_line_done ? header_cols : (seen_any_data ? header_cols : 0);
-    return out;
+    for (std::string_view w = reader.next(); !w.empty(); w = reader.next())
+        counter.feed(w);
+    return counter.finish(has_header);
 }
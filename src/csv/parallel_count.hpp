@@ -0,0 +1,242 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "csv_count.hpp"
+#include "../io/mapped_file.hpp"
+
+namespace csvqr {
+
+// Outcome of counting one byte range from an assumed starting quote state.
+struct range_counts {
+    std::uint64_t rows          = 0;     // row terminators inside the range
+    bool          end_in_quotes = false; // quote state after the last byte
+    bool          at_line_start = true;  // last byte ended a row (or range empty)
+};
+
+// Counter state at an index block boundary inside a range, under both
+// starting quote states (see count_range_speculative's index_block).
+struct range_mark {
+    std::size_t   offset = 0;
+    std::uint64_t rows[2]      = {0, 0};          // row terminators between the range start and offset
+    bool          in_quotes[2] = {false, true};   // quote state at offset
+};
+
+// Both speculative outcomes of one range: [0] = started outside quotes,
+// [1] = started inside quotes. Exactly one is right; the stitch picks it.
+struct speculative_range {
+    std::size_t  begin = 0, end = 0;
+    range_counts as[2];
+    std::vector<range_mark> marks;   // one per multiple of index_block in [begin, end)
+};
+
+inline int resolve_threads(int requested) {
+    if (requested > 0) return requested;
+    const unsigned hw = std::thread::hardware_concurrency();
+    return hw > 0 ? static_cast<int>(hw) : 1;
+}
+
+// Split points that never separate the CR and LF of a CRLF, so no range has
+// to know whether the previous one ended on a CR.
+inline std::vector<std::size_t> split_points(std::string_view data, std::size_t parts) {
+    std::vector<std::size_t> cuts{0};
+    for (std::size_t i = 1; i < parts; ++i) {
+        std::size_t b = data.size() / parts * i;
+        if (b < cuts.back()) b = cuts.back();
+        if (b > 0 && b < data.size() && data[b - 1] == '\r' && data[b] == '\n') ++b;
+        cuts.push_back(b);
+    }
+    cuts.push_back(data.size());
+    return cuts;
+}
+
+// Counts [begin,end) under both starting quote states. The two counters are
+// fed in cache-sized slices so the second one reads from L2, not memory.
+// With index_block > 0, slices also stop at every multiple of index_block
+// and the counters' state there is kept in `marks` (for row_index).
+inline speculative_range count_range_speculative(std::string_view data,
+                                                 std::size_t begin, std::size_t end,
+                                                 char delimiter, char quote,
+                                                 count_kernel kernel = count_kernel::automatic,
+                                                 std::size_t index_block = 0) {
+    constexpr std::size_t slice = 64 * 1024;
+    speculative_range out;
+    out.begin = begin;
+    out.end   = end;
+
+    csv_counter c[2] = { csv_counter(delimiter, quote, kernel), csv_counter(delimiter, quote, kernel) };
+    c[1].in_quotes = true;
+    for (auto& ci : c) ci.first_row_done = true; // columns come from the first row only
+
+    std::size_t mark = index_block == 0 ? end : (begin + index_block - 1) / index_block * index_block;
+    for (std::size_t off = begin; off < end;) {
+        if (off == mark) {
+            out.marks.push_back(range_mark{off, {c[0].rows, c[1].rows}, {c[0].in_quotes, c[1].in_quotes}});
+            mark += index_block;
+        }
+        const std::size_t n = std::min({slice, end - off, mark - off});
+        c[0].feed(data.data() + off, n);
+        c[1].feed(data.data() + off, n);
+        off += n;
+    }
+    for (int s = 0; s < 2; ++s) {
+        out.as[s].rows          = c[s].rows;
+        out.as[s].end_in_quotes = c[s].in_quotes;
+        out.as[s].at_line_start = c[s].at_line_start;
+    }
+    return out;
+}
+
+// Resolves the true starting quote state of every range in order
+// (range 0 starts outside quotes). Returns the start state per range.
+inline std::vector<bool> stitch_quote_states(const std::vector<speculative_range>& ranges) {
+    std::vector<bool> starts(ranges.size());
+    bool s = false;
+    for (std::size_t i = 0; i < ranges.size(); ++i) {
+        starts[i] = s;
+        s = ranges[i].as[s ? 1 : 0].end_in_quotes;
+    }
+    return starts;
+}
+
+// First record start at or after `pos`, given the true quote state at `pos`:
+// `pos` itself if a terminator outside quotes precedes it (pos + 1 between
+// the CR and LF of a CRLF), else the byte after the next LF / CR / CRLF
+// outside quotes (data.size() if there is none).
+inline std::size_t next_record_start(std::string_view data, std::size_t pos, bool in_quotes, char quote) {
+    if (pos == 0) return 0;
+    if (!in_quotes && data[pos - 1] == '\r' && pos < data.size() && data[pos] == '\n') return pos + 1;
+    if (!in_quotes && (data[pos - 1] == '\n' || data[pos - 1] == '\r')) return pos;
+    for (std::size_t i = pos; i < data.size(); ++i) {
+        const char c = data[i];
+        if (c == quote) in_quotes = !in_quotes;
+        else if (!in_quotes && (c == '\n' || c == '\r')) {
+            if (c == '\r' && i + 1 < data.size() && data[i + 1] == '\n') ++i;
+            return i + 1;
+        }
+    }
+    return data.size();
+}
+
+// The speculative pass over a buffer split into `parts` ranges: per-range
+// counts under both starting quote states, the resolved true start states,
+// and the column count of the first row. Reused by the parallel profiler to
+// cut the buffer at record boundaries without a second sequential scan.
+struct speculative_scan {
+    std::vector<std::size_t>       cuts;     // parts + 1 offsets
+    std::vector<speculative_range> ranges;
+    std::vector<bool>              starts;   // true quote state at cuts[i]
+    std::uint32_t                  columns = 0;
+
+    std::size_t parts() const noexcept { return ranges.size(); }
+
+    // True if the buffer ends with a complete record (or is empty), as
+    // csv_counter::at_line_start after feeding it all.
+    bool at_line_start() const noexcept {
+        for (std::size_t i = ranges.size(); i-- > 0;)
+            if (ranges[i].begin != ranges[i].end) return ranges[i].as[starts[i] ? 1 : 0].at_line_start;
+        return true;
+    }
+
+    // Offsets of the first record starting in each range (parts + 1 entries,
+    // non-decreasing; a range may own no record start at all).
+    std::vector<std::size_t> record_starts(std::string_view data, char quote) const {
+        std::vector<std::size_t> out(cuts.size());
+        for (std::size_t i = 0; i < ranges.size(); ++i)
+            out[i] = next_record_start(data, cuts[i], starts[i], quote);
+        out.back() = data.size();
+        for (std::size_t i = 1; i < out.size(); ++i) out[i] = std::max(out[i], out[i - 1]);
+        return out;
+    }
+
+    CsvCounts counts(bool has_header) const {
+        std::uint64_t rows = 0;
+        for (std::size_t i = 0; i < ranges.size(); ++i) {
+            if (ranges[i].begin == ranges[i].end) continue;
+            rows += ranges[i].as[starts[i] ? 1 : 0].rows;
+        }
+        if (!at_line_start()) ++rows;
+
+        CsvCounts out{};
+        out.rows    = (has_header && rows > 0) ? rows - 1 : rows;
+        out.columns = columns;
+        return out;
+    }
+};
+
+// How many ranges a buffer is worth splitting into for `threads` workers.
+inline std::size_t parallel_parts(std::size_t bytes, int threads, std::size_t min_bytes_per_thread = 1u << 20) {
+    if (min_bytes_per_thread == 0) min_bytes_per_thread = 1;
+    const std::size_t parts = static_cast<std::size_t>(resolve_threads(threads));
+    return std::max<std::size_t>(1, std::min(parts, bytes / min_bytes_per_thread));
+}
+
+// Runs count_range_speculative over `parts` ranges, one thread each, and
+// stitches the quote states (index_block: see count_range_speculative).
+inline speculative_scan scan_speculative(std::string_view data, char delimiter, char quote,
+                                         std::size_t parts,
+                                         count_kernel kernel = count_kernel::automatic,
+                                         std::size_t index_block = 0) {
+    speculative_scan sc;
+    // columns: delimiters of the first logical row (usually a few bytes)
+    csv_counter head(delimiter, quote, kernel);
+    for (std::size_t off = 0; off < data.size() && !head.first_row_done; off += 4096)
+        head.feed(data.substr(off, 4096));
+    sc.columns = head.finish(false).columns;
+
+    parts = std::max<std::size_t>(1, parts);
+    sc.cuts = split_points(data, parts);
+    sc.ranges.resize(parts);
+    {
+        std::vector<std::thread> pool;
+        pool.reserve(parts);
+        for (std::size_t i = 0; i < parts; ++i) {
+            pool.emplace_back([&, i] {
+                sc.ranges[i] = count_range_speculative(data, sc.cuts[i], sc.cuts[i + 1], delimiter, quote,
+                                                       kernel, index_block);
+            });
+        }
+        for (auto& t : pool) t.join();
+    }
+    sc.starts = stitch_quote_states(sc.ranges);
+    return sc;
+}
+
+// Multi-threaded exact RFC4180 row/column count over an in-memory buffer
+// (typically a mapped file). Each worker counts its range under both possible
+// starting quote states; the results are stitched in order, so the answer is
+// identical to csv_counter's sequential one.
+inline CsvCounts csv_count_parallel(std::string_view data,
+                                    char delimiter,
+                                    char quote,
+                                    bool has_header,
+                                    int threads = 0,
+                                    count_kernel kernel = count_kernel::automatic,
+                                    std::size_t min_bytes_per_thread = 1u << 20) {
+    const std::size_t parts = parallel_parts(data.size(), threads, min_bytes_per_thread);
+    if (parts == 1) {
+        csv_counter c(delimiter, quote, kernel);
+        c.feed(data);
+        return c.finish(has_header);
+    }
+    return scan_speculative(data, delimiter, quote, parts, kernel).counts(has_header);
+}
+
+// File form: maps the input; inputs that cannot be mapped (pipes) are counted sequentially.
+inline CsvCounts csv_count_parallel(const std::filesystem::path& path,
+                                    char delimiter,
+                                    char quote,
+                                    bool has_header,
+                                    int threads = 0,
+                                    std::size_t chunk_bytes = 262144) {
+    mapped_file map;
+    if (!map.open(path))
+        return csv_count_rows_cols(path, delimiter, quote, chunk_bytes, has_header, read_backend::read);
+    return csv_count_parallel(map.view(), delimiter, quote, has_header, threads);
+}
+
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+namespace csvqr {
+
+// Splits a stream of chunks into logical CSV records (quote-aware).
+// - A record ends at LF, CR or CRLF OUTSIDE quotes; the terminator is not
+//   part of the record. Quoted newlines stay inside the record.
+// - Records fully inside a chunk are handed out as views into that chunk
+//   (no copy); only a record straddling a chunk boundary is stitched in a
+//   carry buffer.
+// - Row semantics match csv_counter: blank lines are records, a final line
+//   without newline is a record, a trailing newline does not add one.
+class record_splitter {
+public:
+    explicit record_splitter(char quote = '"') : quote_(quote) {}
+
+    // Calls on_record(std::string_view) for every record completed by this chunk.
+    // Views are only valid for the duration of the callback.
+    template <class OnRecord>
+    void feed(std::string_view chunk, OnRecord&& on_record) {
+        const std::size_t n = chunk.size();
+        std::size_t i = 0;
+        if (prev_was_cr_) {
+            prev_was_cr_ = false;
+            if (n > 0 && chunk[0] == '\n') i = 1; // LF of a CRLF split across chunks
+        }
+        std::size_t start = i;
+
+        for (; i < n; ++i) {
+            const char c = chunk[i];
+            if (c == quote_) {
+                in_quotes_ = !in_quotes_;
+            } else if (!in_quotes_ && (c == '\n' || c == '\r')) {
+                const std::string_view piece = chunk.substr(start, i - start);
+                if (carry_.empty()) {
+                    on_record(piece);
+                } else {
+                    carry_.append(piece.data(), piece.size());
+                    on_record(std::string_view(carry_));
+                    carry_.clear();
+                }
+                if (c == '\r') {
+                    if (i + 1 < n) { if (chunk[i + 1] == '\n') ++i; }
+                    else prev_was_cr_ = true;
+                }
+                start = i + 1;
+            }
+        }
+        if (start < n) carry_.append(chunk.data() + start, n - start);
+    }
+
+    // Flushes a last record that had no trailing newline.
+    template <class OnRecord>
+    void finish(OnRecord&& on_record) {
+        if (!carry_.empty()) {
+            on_record(std::string_view(carry_));
+            carry_.clear();
+        }
+        in_quotes_ = false;
+        prev_was_cr_ = false;
+    }
+
+private:
+    char        quote_;
+    bool        in_quotes_   = false;
+    bool        prev_was_cr_ = false;
+    std::string carry_;
+};
+
+}
@@ -0,0 +1,175 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "csv_count.hpp"
+#include "parallel_count.hpp"
+#include "../util/serial.hpp"
+
+namespace csvqr {
+
+// Positional summary of one input, kept by the count pass: the input is cut
+// into blocks of block_bytes, and for every block the counter state at its
+// first byte is recorded (records ended before it and the quote state). With
+// it a later run over the same bytes can
+//  - answer the row and column counts without reading the input,
+//  - cut the input into record-aligned ranges for parallel work (a short
+//    next_record_start from each block start instead of a speculative pass),
+//  - seek to record K by scanning at most one block plus one record.
+// Records are physical ones as csv_counter counts them: the header included,
+// a final line without newline included.
+struct row_index {
+    std::uint64_t block_bytes = 0;
+    std::uint64_t size        = 0;   // bytes indexed
+    std::uint64_t records     = 0;
+    std::uint32_t columns     = 0;
+    bool          terminated  = true;   // ends with a terminator outside quotes (or is empty)
+    std::vector<std::uint64_t> rows_before;   // per block: records ended before its first byte
+    std::vector<std::uint8_t>  in_quotes;     // per block: quote state at its first byte
+
+    std::size_t blocks() const noexcept { return rows_before.size(); }
+
+    CsvCounts counts(bool has_header) const noexcept {
+        return CsvCounts{(has_header && records > 0) ? records - 1 : records, columns};
+    }
+
+    // Records that end inside block b.
+    std::uint64_t block_rows(std::size_t b) const noexcept {
+        const std::uint64_t next = b + 1 < blocks() ? rows_before[b + 1] : records;
+        return next - rows_before[b];
+    }
+
+    // Offsets of the first record starting in each of `parts` ranges cut at
+    // block boundaries (parts + 1 non-decreasing entries, the last one
+    // data.size()); the same contract as speculative_scan::record_starts.
+    std::vector<std::size_t> record_starts(std::string_view data, std::size_t parts, char quote) const {
+        parts = std::max<std::size_t>(1, std::min(parts, blocks()));
+        std::vector<std::size_t> out(parts + 1, data.size());
+        out[0] = 0;
+        for (std::size_t i = 1; i < parts; ++i) {
+            const std::size_t b = blocks() * i / parts;
+            out[i] = std::max(out[i - 1], next_record_start(data, block_offset(b), in_quotes[b] != 0, quote));
+        }
+        return out;
+    }
+
+    // Byte offset where record `row` (0-based, header included) starts, or
+    // data.size() if there is no such record.
+    std::size_t seek(std::string_view data, std::uint64_t row, char quote) const {
+        if (row >= records || blocks() == 0) return data.size();
+        // last block whose first record start is at or before `row`
+        std::size_t b = static_cast<std::size_t>(
+            std::upper_bound(rows_before.begin(), rows_before.end(), row) - rows_before.begin());
+        std::size_t pos = 0;
+        std::uint64_t at = 0;
+        while (b-- > 0) {
+            const std::size_t off = block_offset(b);
+            const bool q = in_quotes[b] != 0;
+            at  = rows_before[b] + (off == 0 || (!q && (data[off - 1] == '\n' || data[off - 1] == '\r')) ? 0 : 1);
+            if (at > row) continue;   // `row` starts before this block
+            pos = next_record_start(data, off, q, quote);
+            break;
+        }
+        // walk the remaining records of the block
+        for (bool q = false; at < row && pos < data.size(); ++pos) {
+            const char c = data[pos];
+            if (c == quote) q = !q;
+            else if (!q && (c == '\n' || c == '\r')) {
+                if (c == '\r' && pos + 1 < data.size() && data[pos + 1] == '\n') ++pos;
+                ++at;
+            }
+        }
+        return pos;
+    }
+
+    std::size_t block_offset(std::size_t b) const noexcept {
+        return static_cast<std::size_t>(b * block_bytes);
+    }
+
+    void save(byte_writer& w) const {
+        w.put(block_bytes);
+        w.put(size);
+        w.put(records);
+        w.put(columns);
+        w.put<std::uint8_t>(terminated);
+        w.put_vec(rows_before);
+        w.put_vec(in_quotes);
+    }
+    void load(byte_reader& r) {
+        block_bytes = r.get<std::uint64_t>();
+        size        = r.get<std::uint64_t>();
+        records     = r.get<std::uint64_t>();
+        columns     = r.get<std::uint32_t>();
+        terminated  = r.get<std::uint8_t>() != 0;
+        rows_before = r.get_vec<std::uint64_t>();
+        in_quotes   = r.get_vec<std::uint8_t>();
+        if (block_bytes == 0 || in_quotes.size() != rows_before.size() ||
+            rows_before.size() != (size + block_bytes - 1) / block_bytes)
+            throw std::runtime_error("serialized state is truncated");
+    }
+};
+
+// Builds a row_index alongside a sequential count: feed() every chunk of the
+// input through it instead of straight to the counter.
+class row_index_builder {
+public:
+    explicit row_index_builder(std::size_t block_bytes) : block_(block_bytes > 0 ? block_bytes : 1) {
+        index_.block_bytes = block_;
+    }
+
+    // Feeds `chunk` (the next bytes of the input) to `counter`, stopping at
+    // every block boundary inside it to record the counter's state.
+    void feed(csv_counter& counter, std::string_view chunk) {
+        while (!chunk.empty()) {
+            if (pos_ == next_) {
+                index_.rows_before.push_back(counter.rows);
+                index_.in_quotes.push_back(counter.in_quotes);
+                next_ += block_;
+            }
+            const std::size_t n = static_cast<std::size_t>(std::min<std::uint64_t>(chunk.size(), next_ - pos_));
+            counter.feed(chunk.substr(0, n));
+            chunk.remove_prefix(n);
+            pos_ += n;
+        }
+    }
+
+    row_index finish(const csv_counter& counter) {
+        const CsvCounts c = counter.finish(false);
+        index_.size    = pos_;
+        index_.records = c.rows;
+        index_.columns = c.columns;
+        index_.terminated = counter.at_line_start;
+        return std::move(index_);
+    }
+
+private:
+    std::uint64_t block_;
+    std::uint64_t pos_  = 0;
+    std::uint64_t next_ = 0;
+    row_index     index_;
+};
+
+// The index a parallel count pass run with index_block > 0 leaves behind.
+inline row_index make_row_index(const speculative_scan& sc, std::size_t index_block, std::uint64_t size) {
+    row_index ix;
+    ix.block_bytes = index_block;
+    ix.size        = size;
+    ix.columns     = sc.columns;
+    std::uint64_t base = 0;
+    for (std::size_t i = 0; i < sc.parts(); ++i) {
+        const int s = sc.starts[i] ? 1 : 0;
+        for (const range_mark& m : sc.ranges[i].marks) {
+            ix.rows_before.push_back(base + m.rows[s]);
+            ix.in_quotes.push_back(m.in_quotes[s]);
+        }
+        if (sc.ranges[i].begin != sc.ranges[i].end) base += sc.ranges[i].as[s].rows;
+    }
+    ix.terminated = sc.at_line_start();
+    ix.records    = base + (ix.terminated ? 0 : 1);
+    return ix;
+}
+
+}
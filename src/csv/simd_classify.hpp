@@ -0,0 +1,158 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+// x86-64 only: SSE2 is part of the baseline ISA there.
+#if defined(__x86_64__) || defined(_M_X64)
+  #define CSVQR_X86 1
+  #include <immintrin.h>
+  #if defined(_MSC_VER) && !defined(__clang__)
+    #include <intrin.h>
+  #endif
+#else
+  #define CSVQR_X86 0
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+  #define CSVQR_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+  #define CSVQR_TARGET_AVX2
+#endif
+
+namespace csvqr {
+
+// Structural characters of one 64-byte block, one bit per byte (bit i = byte i).
+struct block_masks {
+    std::uint64_t quote = 0;
+    std::uint64_t delim = 0;
+    std::uint64_t lf    = 0;
+    std::uint64_t cr    = 0;
+};
+
+// Which classifier feeds the bitmask counter. scalar = the byte-at-a-time loop.
+enum class count_kernel { automatic, scalar, sse2, avx2 };
+
+inline const char* to_string(count_kernel k) {
+    switch (k) {
+        case count_kernel::scalar: return "scalar";
+        case count_kernel::sse2:   return "sse2";
+        case count_kernel::avx2:   return "avx2";
+        default:                   return "auto";
+    }
+}
+
+inline bool cpu_has_avx2() noexcept {
+#if CSVQR_X86 && (defined(__GNUC__) || defined(__clang__))
+    return __builtin_cpu_supports("avx2");
+#elif CSVQR_X86 && defined(_MSC_VER)
+    int r[4]{};
+    __cpuid(r, 0);
+    if (r[0] < 7) return false;
+    __cpuid(r, 1);
+    const bool osxsave = (r[2] & (1 << 27)) != 0;
+    const bool avx     = (r[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx) return false;
+    if ((_xgetbv(0) & 0x6) != 0x6) return false; // OS saves XMM+YMM state
+    __cpuidex(r, 7, 0);
+    return (r[1] & (1 << 5)) != 0;
+#else
+    return false;
+#endif
+}
+
+inline bool kernel_supported(count_kernel k) noexcept {
+    switch (k) {
+        case count_kernel::scalar: return true;
+        case count_kernel::sse2:   return CSVQR_X86 != 0;
+        case count_kernel::avx2:   return cpu_has_avx2();
+        default:                   return true;
+    }
+}
+
+// Best kernel for this CPU (runtime dispatch).
+inline count_kernel resolve_kernel(count_kernel k) noexcept {
+    if (k != count_kernel::automatic) return kernel_supported(k) ? k : count_kernel::scalar;
+    if (cpu_has_avx2()) return count_kernel::avx2;
+    if (CSVQR_X86)      return count_kernel::sse2;
+    return count_kernel::scalar;
+}
+
+// Inclusive prefix XOR: bit i = b0 ^ b1 ^ ... ^ bi. Turns quote positions into
+// an "inside quotes" mask (toggle semantics; "" toggles twice).
+inline std::uint64_t prefix_xor(std::uint64_t x) noexcept {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+inline int popcount64(std::uint64_t x) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(x);
+#else
+    int n = 0;
+    while (x) { x &= x - 1; ++n; }
+    return n;
+#endif
+}
+
+inline int ctz64(std::uint64_t x) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(x);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long i = 0;
+    _BitScanForward64(&i, x);
+    return static_cast<int>(i);
+#else
+    int n = 0;
+    while (!(x & 1u)) { x >>= 1; ++n; }
+    return n;
+#endif
+}
+
+// ---------- classifiers (64 bytes -> 4 bitmasks) ----------
+#if CSVQR_X86
+struct classify_sse2 {
+    static block_masks run(const char* p, char delim, char quote) noexcept {
+        const __m128i vq = _mm_set1_epi8(quote);
+        const __m128i vd = _mm_set1_epi8(delim);
+        const __m128i vl = _mm_set1_epi8('\n');
+        const __m128i vr = _mm_set1_epi8('\r');
+        block_masks m;
+        for (int k = 0; k < 4; ++k) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * k));
+            const int sh = 16 * k;
+            m.quote |= std::uint64_t(std::uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, vq)))) << sh;
+            m.delim |= std::uint64_t(std::uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, vd)))) << sh;
+            m.lf    |= std::uint64_t(std::uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, vl)))) << sh;
+            m.cr    |= std::uint64_t(std::uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, vr)))) << sh;
+        }
+        return m;
+    }
+};
+
+struct classify_avx2 {
+    CSVQR_TARGET_AVX2 static block_masks run(const char* p, char delim, char quote) noexcept {
+        const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+        block_masks m;
+        m.quote = eq_mask(lo, hi, _mm256_set1_epi8(quote));
+        m.delim = eq_mask(lo, hi, _mm256_set1_epi8(delim));
+        m.lf    = eq_mask(lo, hi, _mm256_set1_epi8('\n'));
+        m.cr    = eq_mask(lo, hi, _mm256_set1_epi8('\r'));
+        return m;
+    }
+
+private:
+    CSVQR_TARGET_AVX2 static std::uint64_t eq_mask(__m256i lo, __m256i hi, __m256i needle) noexcept {
+        const std::uint64_t l = std::uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, needle)));
+        const std::uint64_t h = std::uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, needle)));
+        return l | (h << 32);
+    }
+};
+#endif
+
+}
@@ -1,102 +1,141 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
-#include <fstream>
-#include <string>
 #include <string_view>
+#include <vector>
 
-// Count rows and columns without materializing cells.
-// Handles RFC4180 quotes, CRLF, delimiters only when not in quotes.
-// Columns = token count in the first logical row (header or first data row).
-struct CsvCounts {
-    uint64_t rows = 0;        // logical rows (line breaks not in quotes)
-    uint64_t columns = 0;     // tokens in first row
-};
+#include "record_view.hpp"
+#include "../util/arena.hpp"
 
-inline CsvCounts csv_count_rows_cols(std::string_view path,
-                                     char delimiter = ',',
-                                     char quote = '"',
-                                     size_t chunk_bytes = 262144,
-                                     bool has_header = true)
-{
-    std::ifstream is(std::string(path), std::ios::binary);
-    if (!is) throw std::runtime_error("csv_count_rows_cols: cannot open file");
+// Row/column counting lives in csv_count.hpp (scalar + SIMD kernels).
+#include "csv_count.hpp"
 
-    std::string buf;
-    buf.resize(chunk_bytes);
+namespace csvqr {
 
-    bool in_quotes = false;
-    bool first_row_done = false;
-    uint64_t rows = 0;
-    uint64_t first_row_cols = 0;
-    uint64_t cur_cols = 1; // columns = delimiters + 1, when not in quotes
-    bool at_line_start = true;
+// Zero-copy field tokenizer for one logical record (no line terminator, as
+// produced by record_splitter).
+// - Unquoted fields and plain quoted fields ("abc") become views into the
+//   record itself; only the surrounding quotes are dropped.
+// - Fields that need rewriting (escaped "" or stray quotes mid-field) are
+//   unescaped into the caller's scratch arena, which the caller resets per batch.
+// - Output matches parse_csv_line field for field, but `out` is reused, so a
+//   steady-state loop performs no heap allocation.
+//
+// Projection: with set_projection(), only the selected fields are emitted, in
+// source order. Unselected fields are skipped structurally (quote toggling to
+// the next delimiter: no unescaping, no output), and the rest of the record is
+// not looked at once the last selected field is done, so cost follows the
+// selected columns rather than the table width.
+class record_tokenizer {
+public:
+    record_tokenizer(char delim = ',', char quote = '"') : delim_(delim), quote_(quote) {}
 
-    // Track if previous char was CR to swallow CRLF as one newline
-    bool prev_was_cr = false;
+    // keep[i]: emit source field i; fields past keep.size() follow keep_rest.
+    void set_projection(std::vector<std::uint8_t> keep, bool keep_rest) {
+        keep_ = std::move(keep);
+        keep_rest_ = keep_rest;
+        stop_after_ = 0;
+        for (std::size_t i = 0; i < keep_.size(); ++i) if (keep_[i]) stop_after_ = i + 1;
+        projected_ = true;
+    }
+    void clear_projection() noexcept { keep_.clear(); projected_ = false; }
+    bool projected() const noexcept { return projected_; }
 
-    auto finish_row = [&]() {
-        rows++;
-        if (!first_row_done) {
-            first_row_cols = cur_cols;
-            first_row_done = true;
+    void tokenize(std::string_view rec, record_view& out, arena& scratch) const {
+        if (projected_) { tokenize_projected(rec, out, scratch); return; }
+        out.clear();
+        const std::size_t n = rec.size();
+        std::size_t i = 0;
+        for (;;) {
+            i = parse_field(rec, i, out, scratch);
+            if (i >= n) break;
+            ++i; // delimiter; a trailing one yields a final empty field
         }
-        cur_cols = 1;
-        at_line_start = true;
-    };
-
-    while (is) {
-        is.read(buf.data(), static_cast<std::streamsize>(buf.size()));
-        std::streamsize n = is.gcount();
-        if (n <= 0) break;
+    }
 
-        for (std::streamsize i = 0; i < n; ++i) {
-            char c = buf[static_cast<size_t>(i)];
+    char delimiter() const noexcept { return delim_; }
+    char quote()     const noexcept { return quote_; }
 
-            if (prev_was_cr) {
-                // If LF follows CR, treat CRLF as a single newline.
-                prev_was_cr = false;
-                if (c == '\n') {
-                    continue; // already finished row on CR
-                }
+private:
+    // One field starting at i; returns the index of its delimiter (or rec.size()).
+    std::size_t parse_field(std::string_view rec, std::size_t i, record_view& out, arena& scratch) const {
+        const std::size_t n = rec.size();
+        if (i < n && rec[i] == quote_) {
+            const std::size_t close = rec.find(quote_, i + 1);
+            if (close != std::string_view::npos && (close + 1 == n || rec[close + 1] == delim_)) {
+                out.push(rec.substr(i + 1, close - i - 1));
+                return close + 1;
             }
+            return unescape_field(rec, i, out, scratch);
+        }
+        std::size_t j = i;
+        while (j < n && rec[j] != delim_ && rec[j] != quote_) ++j;
+        if (j < n && rec[j] == quote_) return unescape_field(rec, i, out, scratch);
+        out.push(rec.substr(i, j - i));
+        return j;
+    }
 
-            if (c == quote) {
-                // Double quote inside quotes -> escaped quote; advance over the next quote
-                if (in_quotes) {
-                    // Lookahead: if the next char is also a quote, it's an escaped quote
-                    if (i + 1 < n && buf[static_cast<size_t>(i + 1)] == quote) {
-                        ++i; // consume the escaped quote
-                    } else {
-                        in_quotes = false;
-                    }
+    // Same field boundary as parse_field ("" toggles twice), nothing emitted.
+    std::size_t skip_field(std::string_view rec, std::size_t i) const noexcept {
+        const std::size_t n = rec.size();
+        bool inq = false;
+        for (; i < n; ++i) {
+            const char c = rec[i];
+            if (c == quote_) inq = !inq;
+            else if (!inq && c == delim_) break;
+        }
+        return i;
+    }
+
+    void tokenize_projected(std::string_view rec, record_view& out, arena& scratch) const {
+        out.clear();
+        const std::size_t n = rec.size();
+        std::size_t i = 0;
+        for (std::size_t f = 0;; ++f) {
+            const bool want = f < keep_.size() ? keep_[f] != 0 : keep_rest_;
+            i = want ? parse_field(rec, i, out, scratch) : skip_field(rec, i);
+            if (i >= n) break;
+            if (!keep_rest_ && f + 1 >= stop_after_) break;   // nothing selected further right
+            ++i;
+        }
+    }
+
+    // Slow path: same state machine as parse_csv_line, written into the arena.
+    // Returns the index of the terminating delimiter (or rec.size()).
+    std::size_t unescape_field(std::string_view rec, std::size_t i, record_view& out, arena& scratch) const {
+        const std::size_t n = rec.size();
+        const std::size_t cap = n - i;
+        char* dst = scratch.allocate(cap);
+        std::size_t len = 0;
+        bool inq = false;
+        for (; i < n; ++i) {
+            const char c = rec[i];
+            if (inq) {
+                if (c == quote_) {
+                    if (i + 1 < n && rec[i + 1] == quote_) { dst[len++] = quote_; ++i; }
+                    else inq = false;
                 } else {
-                    in_quotes = true;
+                    dst[len++] = c;
                 }
-                at_line_start = false;
-            } else if (!in_quotes && c == delimiter) {
-                ++cur_cols;
-                at_line_start = false;
-            } else if (!in_quotes && (c == '\n' || c == '\r')) {
-                finish_row();
-                if (c == '\r') prev_was_cr = true; // swallow following \n
+            } else if (c == quote_) {
+                inq = true;
+            } else if (c == delim_) {
+                break;
             } else {
-                at_line_start = false;
+                dst[len++] = c;
             }
         }
+        scratch.shrink_last(dst, cap, len);
+        out.push(std::string_view(dst, len));
+        return i;
     }
 
-    // Handle last line if file didn’t end with newline (and we saw any non-newline chars)
-    if (!at_line_start) {
-        finish_row();
-    }
-
-    // If header declared, treat rows as data rows (minus header if present)
-    if (has_header && rows > 0) {
-        rows -= 1;
-    }
+    char delim_;
+    char quote_;
+    bool                      projected_  = false;
+    bool                      keep_rest_  = true;
+    std::size_t               stop_after_ = 0;
+    std::vector<std::uint8_t> keep_;
+};
 
-    CsvCounts out;
-    out.rows = rows;
-    out.columns = first_row_cols > 0 ? first_row_cols : 0;
-    return out;
 }
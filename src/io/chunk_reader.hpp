@@ -1,40 +1,208 @@
 #pragma once
+#include <algorithm>
+#include <chrono>
 #include <filesystem>
+#include <memory>
 #include <fstream>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <cstdint>
 #include <stdexcept>
 
+#include "mapped_file.hpp"
+#include "read_ahead.hpp"
+
+#if !defined(_WIN32)
+  #include <cerrno>
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
+
 namespace csvqr {
 
+// Where chunk_reader gets its bytes from.
+//  - mmap:      zero-copy windows into a read-only mapping of the file
+//  - read:      read(2) (ifstream on Windows) into one reused buffer;
+//               works for pipes/FIFOs and anything that cannot be mapped
+//  - async:     read_ahead ring (io_uring or a reader thread) so disk reads
+//               overlap parsing; also works for pipes
+//  - automatic: mmap when possible (the kernel's readahead already overlaps
+//               page-ins with parsing), otherwise async
+enum class read_backend { automatic, mmap, read, async };
+
+inline const char* to_string(read_backend b) {
+    switch (b) {
+        case read_backend::mmap: return "mmap";
+        case read_backend::read: return "read";
+        case read_backend::async: return "async";
+        default:                 return "auto";
+    }
+}
+
+inline read_backend parse_read_backend(std::string_view s) {
+    if (s == "mmap") return read_backend::mmap;
+    if (s == "read") return read_backend::read;
+    if (s == "async") return read_backend::async;
+    if (s == "auto" || s.empty()) return read_backend::automatic;
+    throw std::invalid_argument("unknown read backend: " + std::string(s));
+}
+
 class chunk_reader {
 public:
-    chunk_reader(const std::filesystem::path& p, std::size_t chunk_bytes)
-        : path_(p), buf_(chunk_bytes)
+    // read_ahead_depth: buffers in the async ring (in flight + the one being parsed).
+    // offset: first byte handed out (resuming after a prefix already scanned).
+    chunk_reader(const std::filesystem::path& p, std::size_t chunk_bytes,
+                 read_backend backend = read_backend::automatic,
+                 std::size_t read_ahead_depth = 4,
+                 std::uint64_t offset = 0)
+        : path_(p), chunk_(chunk_bytes)
     {
         if (chunk_bytes == 0) throw std::invalid_argument("chunk_bytes == 0");
+
+        const bool try_map = backend == read_backend::automatic || backend == read_backend::mmap;
+        if (try_map && map_.open(path_)) {
+            backend_ = read_backend::mmap;
+            pos_ = static_cast<std::size_t>(std::min<std::uint64_t>(offset, map_.size()));
+            return;
+        }
+        if (backend == read_backend::mmap)
+            throw std::runtime_error("Failed to map file: " + path_.string());
+
+        if (backend != read_backend::read) {
+            backend_ = read_backend::async;
+            ahead_ = std::make_unique<read_ahead>(path_, chunk_bytes, read_ahead_depth, offset);
+            return;
+        }
+
+        backend_ = read_backend::read;
+        buf_.resize(chunk_bytes);
+#if defined(_WIN32)
         in_.open(path_, std::ios::binary);
         if (!in_) throw std::runtime_error("Failed to open file: " + path_.string());
+        if (offset > 0) in_.seekg(static_cast<std::streamoff>(offset));
+#else
+        fd_ = ::open(path_.c_str(), O_RDONLY);
+        if (fd_ < 0) throw std::runtime_error("Failed to open file: " + path_.string());
+  #if defined(POSIX_FADV_SEQUENTIAL)
+        ::posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+  #endif
+        if (offset > 0 && ::lseek(fd_, static_cast<off_t>(offset), SEEK_SET) < 0)
+            throw std::runtime_error("Seek failed: " + path_.string());
+#endif
+    }
+
+    chunk_reader(const chunk_reader&) = delete;
+    chunk_reader& operator=(const chunk_reader&) = delete;
+
+    ~chunk_reader() {
+#if !defined(_WIN32)
+        if (fd_ >= 0) ::close(fd_);
+#endif
     }
 
-    // Returns number of bytes read; 0 = EOF
+    // Next window of up to chunk_bytes; empty view = EOF.
+    // The view stays valid until the next call to next().
+    std::string_view next() {
+        if (backend_ == read_backend::mmap) {
+            // the window handed out last time is now consumed
+            if (last_len_ > 0) map_.release(pos_ - last_len_, last_len_);
+            const std::size_t n = std::min(chunk_, map_.size() - pos_);
+            std::string_view w(map_.data() + pos_, n);
+            pos_ += n;
+            last_len_ = n;
+            return w;
+        }
+        if (ahead_) {
+            const std::string_view w = ahead_->next();
+            ahead_eof_ = w.empty();
+            return w;
+        }
+        const auto t0 = std::chrono::steady_clock::now();
+        const std::string_view w = read_some();
+        read_wait_ns_ += static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - t0).count());
+        return w;
+    }
+
+    // Copying form kept for callers that own their buffer; returns bytes read (0 = EOF).
     std::size_t next(std::string& out) {
-        if (!in_) return 0;
-        in_.read(reinterpret_cast<char*>(buf_.data()),
-                 static_cast<std::streamsize>(buf_.size()));
-        auto got = static_cast<std::size_t>(in_.gcount());
-        out.assign(reinterpret_cast<const char*>(buf_.data()), got);
-        return got;
+        const std::string_view w = next();
+        out.assign(w.data(), w.size());
+        return w.size();
+    }
+
+    bool eof() {
+        if (backend_ == read_backend::mmap) return pos_ >= map_.size();
+        if (ahead_) return ahead_eof_;  // known once next() has returned empty
+#if defined(_WIN32)
+        // non-const: std::istream::peek() is non-const
+        return in_.peek() == std::char_traits<char>::eof();
+#else
+        return at_eof_;
+#endif
+    }
+
+    read_backend backend() const noexcept { return backend_; }
+
+    // Time next() spent blocked on I/O: the whole read(2) for the read backend,
+    // only the not-yet-ready part for async. Page faults of the mmap backend
+    // are not visible here (they land in the parse time).
+    double io_wait_ms() const noexcept {
+        if (ahead_) return ahead_->wait_ms();
+        return static_cast<double>(read_wait_ns_) / 1e6;
     }
+    bool uses_io_uring() const noexcept { return ahead_ && ahead_->uses_io_uring(); }
+    bool is_mapped() const noexcept { return backend_ == read_backend::mmap; }
 
-    // non-const: std::istream::peek() is non-const
-    bool eof() { return in_.peek() == std::char_traits<char>::eof(); }
+    // Whole file when mapped (empty otherwise); lets random-access stages share the mapping.
+    std::string_view mapped() const noexcept {
+        return is_mapped() ? map_.view() : std::string_view{};
+    }
 
 private:
+    std::string_view read_some() {
+#if defined(_WIN32)
+        if (!in_) return {};
+        in_.read(buf_.data(), static_cast<std::streamsize>(buf_.size()));
+        const auto got = static_cast<std::size_t>(in_.gcount());
+        return {buf_.data(), got};
+#else
+        // fill the buffer (pipes return short reads) unless EOF comes first
+        std::size_t got = 0;
+        while (!at_eof_ && got < buf_.size()) {
+            const ssize_t r = ::read(fd_, buf_.data() + got, buf_.size() - got);
+            if (r > 0) { got += static_cast<std::size_t>(r); continue; }
+            if (r < 0 && errno == EINTR) continue;
+            if (r < 0) throw std::runtime_error("Read failed: " + path_.string());
+            at_eof_ = true;
+        }
+        return {buf_.data(), got};
+#endif
+    }
+
     std::filesystem::path path_;
+    std::size_t  chunk_;
+    read_backend backend_ = read_backend::read;
+
+    // mmap backend
+    mapped_file  map_;
+    std::size_t  pos_      = 0;
+    std::size_t  last_len_ = 0;
+
+    // async backend
+    std::unique_ptr<read_ahead> ahead_;
+    bool                        ahead_eof_ = false;
+
+    // read backend
+    std::vector<char> buf_;
+    std::uint64_t     read_wait_ns_ = 0;
+#if defined(_WIN32)
     std::ifstream in_;
-    std::vector<unsigned char> buf_;
+#else
+    int  fd_     = -1;
+    bool at_eof_ = false;
+#endif
 };
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include <filesystem>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_WIN32)
+  #ifndef NOMINMAX
+  #define NOMINMAX
+  #endif
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+namespace csvqr {
+
+// Read-only memory mapping of a whole regular file.
+// open() returns false (and leaves the object closed) when the path cannot be
+// mapped: not a regular file (pipe, FIFO, char device), or the OS refuses.
+// Callers are expected to fall back to plain reads in that case.
+class mapped_file {
+public:
+    mapped_file() = default;
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+    ~mapped_file() { close(); }
+
+    bool open(const std::filesystem::path& p) {
+        close();
+#if defined(_WIN32)
+        file_ = CreateFileW(p.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) return false;
+        if (GetFileType(file_) != FILE_TYPE_DISK) { close(); return false; }
+        LARGE_INTEGER sz{};
+        if (!GetFileSizeEx(file_, &sz) ||
+            static_cast<std::uint64_t>(sz.QuadPart) > static_cast<std::uint64_t>(SIZE_MAX)) {
+            close(); return false;
+        }
+        size_ = static_cast<std::size_t>(sz.QuadPart);
+        if (size_ == 0) return true; // nothing to map; valid empty view
+        mapping_ = CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping_) { close(); return false; }
+        data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+        if (!data_) { close(); return false; }
+        return true;
+#else
+        fd_ = ::open(p.c_str(), O_RDONLY);
+        if (fd_ < 0) return false;
+        struct stat st{};
+        if (::fstat(fd_, &st) != 0 || !S_ISREG(st.st_mode) ||
+            static_cast<std::uint64_t>(st.st_size) > static_cast<std::uint64_t>(SIZE_MAX)) {
+            close(); return false;
+        }
+        size_ = static_cast<std::size_t>(st.st_size);
+        if (size_ == 0) return true;
+        void* m = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+        if (m == MAP_FAILED) { close(); return false; }
+        data_ = static_cast<const char*>(m);
+        advise_sequential();
+        return true;
+#endif
+    }
+
+    void close() noexcept {
+#if defined(_WIN32)
+        if (data_) UnmapViewOfFile(data_);
+        if (mapping_) CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+        mapping_ = nullptr;
+        file_ = INVALID_HANDLE_VALUE;
+#else
+        if (data_) ::munmap(const_cast<char*>(data_), size_);
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    bool is_open() const noexcept {
+#if defined(_WIN32)
+        return file_ != INVALID_HANDLE_VALUE;
+#else
+        return fd_ >= 0;
+#endif
+    }
+    const char*      data() const noexcept { return data_; }
+    std::size_t      size() const noexcept { return size_; }
+    std::string_view view() const noexcept { return {data_, size_}; }
+
+    // Hint that [off, off+len) has been consumed and its pages may be dropped
+    // from this process' resident set (the kernel page cache keeps them).
+    // Keeps RSS bounded by the window size on multi-GB inputs.
+    void release(std::size_t off, std::size_t len) const noexcept {
+#if !defined(_WIN32) && defined(MADV_DONTNEED)
+        if (!data_ || len == 0) return;
+        const std::size_t page = page_size();
+        const std::size_t begin = (off + page - 1) / page * page;   // only whole pages
+        const std::size_t end   = (off + len) / page * page;
+        if (end > begin) ::madvise(const_cast<char*>(data_) + begin, end - begin, MADV_DONTNEED);
+#else
+        (void)off; (void)len;
+#endif
+    }
+
+private:
+#if !defined(_WIN32)
+    void advise_sequential() const noexcept {
+  #if defined(MADV_SEQUENTIAL)
+        ::madvise(const_cast<char*>(data_), size_, MADV_SEQUENTIAL);
+  #endif
+  #if defined(MADV_HUGEPAGE)
+        // Only honoured where the kernel supports THP for file mappings; harmless otherwise.
+        ::madvise(const_cast<char*>(data_), size_, MADV_HUGEPAGE);
+  #endif
+    }
+    static std::size_t page_size() noexcept {
+        const long p = ::sysconf(_SC_PAGESIZE);
+        return p > 0 ? static_cast<std::size_t>(p) : 4096u;
+    }
+    int fd_ = -1;
+#else
+    HANDLE file_    = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#endif
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+}
@@ -0,0 +1,296 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32)
+  #include <cerrno>
+  #include <fcntl.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+// io_uring is opt-in at build time (CMake: -DCSVQR_WITH_IO_URING=ON, links liburing).
+#if defined(CSVQR_WITH_IO_URING) && defined(__linux__) && __has_include(<liburing.h>)
+  #include <liburing.h>
+  #define CSVQR_IO_URING 1
+#else
+  #define CSVQR_IO_URING 0
+#endif
+
+namespace csvqr {
+
+// Asynchronous read-ahead over a ring of `depth` buffers of chunk_bytes each:
+// while the caller parses buffer i, buffers i+1 .. i+depth-1 are being filled.
+//  - io_uring (when built in and the input is a regular file): up to `depth`
+//    reads in flight, each buffer re-submitted as soon as the caller is done with it
+//  - otherwise a dedicated reader thread fills free slots with read(2)
+// Chunks come back in file order; wait_ms() is the time next() spent blocked
+// because the next buffer was not ready yet (i.e. I/O the ring failed to hide).
+// Reading starts at byte `offset` of the file (0 = the beginning).
+class read_ahead {
+public:
+    read_ahead(const std::filesystem::path& p, std::size_t chunk_bytes, std::size_t depth = 4,
+               std::uint64_t offset = 0)
+        : path_(p), chunk_(chunk_bytes), slots_(depth < 2 ? 2 : depth)
+    {
+        if (chunk_bytes == 0) throw std::invalid_argument("chunk_bytes == 0");
+        for (auto& s : slots_) s.buf.resize(chunk_);
+
+#if defined(_WIN32)
+        in_.open(path_, std::ios::binary);
+        if (!in_) throw std::runtime_error("Failed to open file: " + path_.string());
+        if (offset > 0) in_.seekg(static_cast<std::streamoff>(offset));
+#else
+        fd_ = ::open(path_.c_str(), O_RDONLY);
+        if (fd_ < 0) throw std::runtime_error("Failed to open file: " + path_.string());
+  #if defined(POSIX_FADV_SEQUENTIAL)
+        ::posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+  #endif
+#endif
+
+#if CSVQR_IO_URING
+        if (start_uring(offset)) return;
+#endif
+#if !defined(_WIN32)
+        if (offset > 0 && ::lseek(fd_, static_cast<off_t>(offset), SEEK_SET) < 0)
+            throw std::runtime_error("Seek failed: " + path_.string());
+#endif
+        worker_ = std::thread([this] { fill_loop(); });
+    }
+
+    read_ahead(const read_ahead&) = delete;
+    read_ahead& operator=(const read_ahead&) = delete;
+
+    ~read_ahead() {
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            stop_ = true;
+        }
+        can_fill_.notify_all();
+        if (worker_.joinable()) worker_.join();
+#if CSVQR_IO_URING
+        if (uring_) {
+            // drain what is still in flight before the buffers go away
+            while (in_flight_ > 0) {
+                io_uring_cqe* cqe = nullptr;
+                if (io_uring_wait_cqe(&ring_, &cqe) < 0) break;
+                io_uring_cqe_seen(&ring_, cqe);
+                --in_flight_;
+            }
+            io_uring_queue_exit(&ring_);
+        }
+#endif
+#if !defined(_WIN32)
+        if (fd_ >= 0) ::close(fd_);
+#endif
+    }
+
+    // Next chunk (up to chunk_bytes; short only at EOF); empty view = EOF.
+    // The view stays valid until the next call to next().
+    std::string_view next() {
+#if CSVQR_IO_URING
+        if (uring_) return next_uring();
+#endif
+        std::unique_lock<std::mutex> lk(mu_);
+        if (holding_) {
+            // the slot handed out last time is consumed: give it back to the reader
+            holding_ = false;
+            read_idx_ = (read_idx_ + 1) % slots_.size();
+            --filled_;
+            can_fill_.notify_one();
+        }
+        if (filled_ == 0 && !done_) {
+            const auto t0 = std::chrono::steady_clock::now();
+            can_read_.wait(lk, [&] { return filled_ > 0 || done_; });
+            wait_ns_ += elapsed_ns(t0);
+        }
+        if (error_) std::rethrow_exception(error_);
+        if (filled_ == 0) return {};
+        const slot& s = slots_[read_idx_];
+        if (s.len == 0) return {};
+        holding_ = true;
+        return {s.buf.data(), s.len};
+    }
+
+    double      wait_ms()       const noexcept { return static_cast<double>(wait_ns_) / 1e6; }
+    std::size_t depth()         const noexcept { return slots_.size(); }
+    bool        uses_io_uring() const noexcept {
+#if CSVQR_IO_URING
+        return uring_;
+#else
+        return false;
+#endif
+    }
+
+private:
+    struct slot {
+        std::vector<char> buf;
+        std::size_t len = 0;
+        bool        ready = false;   // io_uring: completion seen
+    };
+
+    static std::uint64_t elapsed_ns(std::chrono::steady_clock::time_point t0) {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - t0).count());
+    }
+
+    // Blocking fill of one buffer (pipes return short reads); returns bytes read.
+    std::size_t read_full(char* dst, std::size_t cap) {
+#if defined(_WIN32)
+        in_.read(dst, static_cast<std::streamsize>(cap));
+        return static_cast<std::size_t>(in_.gcount());
+#else
+        std::size_t got = 0;
+        while (got < cap) {
+            const ssize_t r = ::read(fd_, dst + got, cap - got);
+            if (r > 0) { got += static_cast<std::size_t>(r); continue; }
+            if (r < 0 && errno == EINTR) continue;
+            if (r < 0) throw std::runtime_error("Read failed: " + path_.string());
+            break; // EOF
+        }
+        return got;
+#endif
+    }
+
+    // ---------- reader thread ----------
+    void fill_loop() {
+        std::size_t w = 0;
+        try {
+            for (;;) {
+                {
+                    std::unique_lock<std::mutex> lk(mu_);
+                    can_fill_.wait(lk, [&] { return stop_ || filled_ < slots_.size(); });
+                    if (stop_) return;
+                }
+                // slot w is free: the consumer only touches filled slots
+                slot& s = slots_[w];
+                s.len = read_full(s.buf.data(), s.buf.size());
+                {
+                    std::lock_guard<std::mutex> lk(mu_);
+                    if (s.len > 0) ++filled_;
+                    if (s.len < s.buf.size()) done_ = true;
+                }
+                can_read_.notify_one();
+                if (s.len < s.buf.size()) return;
+                w = (w + 1) % slots_.size();
+            }
+        } catch (...) {
+            {
+                std::lock_guard<std::mutex> lk(mu_);
+                error_ = std::current_exception();
+                done_ = true;
+            }
+            can_read_.notify_one();
+        }
+    }
+
+#if CSVQR_IO_URING
+    // ---------- io_uring ----------
+    bool start_uring(std::uint64_t offset) {
+        struct stat st{};
+        if (::fstat(fd_, &st) != 0 || !S_ISREG(st.st_mode)) return false; // pipes: thread
+        if (io_uring_queue_init(static_cast<unsigned>(slots_.size()), &ring_, 0) < 0) return false;
+        uring_ = true;
+        file_size_ = static_cast<std::uint64_t>(st.st_size);
+        submit_off_ = consumed_off_ = offset;
+        for (std::size_t i = 0; i < slots_.size(); ++i) submit(i);
+        io_uring_submit(&ring_);
+        return true;
+    }
+
+    void submit(std::size_t i) {
+        slot& s = slots_[i];
+        s.ready = false;
+        s.len = 0;
+        if (submit_off_ >= file_size_) { s.ready = true; return; } // past EOF: empty slot
+        io_uring_sqe* sqe = io_uring_get_sqe(&ring_);
+        io_uring_prep_read(sqe, fd_, s.buf.data(), static_cast<unsigned>(s.buf.size()), submit_off_);
+        io_uring_sqe_set_data64(sqe, i);
+        submit_off_ += s.buf.size();
+        ++in_flight_;
+    }
+
+    std::string_view next_uring() {
+        if (holding_) {
+            holding_ = false;
+            submit(read_idx_);
+            io_uring_submit(&ring_);
+            read_idx_ = (read_idx_ + 1) % slots_.size();
+        }
+        slot& s = slots_[read_idx_];
+        if (!s.ready) {
+            const auto t0 = std::chrono::steady_clock::now();
+            while (!s.ready) {
+                io_uring_cqe* cqe = nullptr;
+                const int rc = io_uring_wait_cqe(&ring_, &cqe);
+                if (rc == -EINTR) continue;
+                if (rc < 0) throw std::runtime_error("io_uring wait failed: " + path_.string());
+                slot& done = slots_[static_cast<std::size_t>(io_uring_cqe_get_data64(cqe))];
+                const int res = cqe->res;
+                io_uring_cqe_seen(&ring_, cqe);
+                --in_flight_;
+                if (res < 0) throw std::runtime_error("Read failed: " + path_.string());
+                done.len = static_cast<std::size_t>(res);
+                done.ready = true;
+            }
+            wait_ns_ += elapsed_ns(t0);
+        }
+        // a short read before EOF (rare on regular files): complete it synchronously
+        const std::uint64_t off = consumed_off_;
+        const std::size_t want = static_cast<std::size_t>(std::min<std::uint64_t>(s.buf.size(),
+                                     file_size_ > off ? file_size_ - off : 0));
+        while (s.len < want) {
+            const ssize_t r = ::pread(fd_, s.buf.data() + s.len, want - s.len,
+                                      static_cast<off_t>(off + s.len));
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) break;
+            s.len += static_cast<std::size_t>(r);
+        }
+        consumed_off_ += s.buf.size();
+        if (s.len == 0) return {};
+        holding_ = true;
+        return {s.buf.data(), s.len};
+    }
+
+    io_uring      ring_{};
+    bool          uring_        = false;
+    std::uint64_t file_size_    = 0;
+    std::uint64_t submit_off_   = 0;
+    std::uint64_t consumed_off_ = 0;
+    std::size_t   in_flight_    = 0;
+#endif
+
+    std::filesystem::path path_;
+    std::size_t           chunk_;
+    std::vector<slot>     slots_;
+
+    std::mutex              mu_;
+    std::condition_variable can_fill_, can_read_;
+    std::size_t             read_idx_ = 0;
+    std::size_t             filled_   = 0;
+    bool                    holding_  = false;
+    bool                    done_     = false;
+    bool                    stop_     = false;
+    std::exception_ptr      error_;
+    std::thread             worker_;
+    std::uint64_t           wait_ns_  = 0;
+
+#if defined(_WIN32)
+    std::ifstream in_;
+#else
+    int fd_ = -1;
+#endif
+};
+
+}
@@ -9,6 +9,7 @@
 #include <system_error>
 #include <cstdint>
 #include <chrono>
+#include <optional>
 
 #if defined(_WIN32)
   #ifndef NOMINMAX
@@ -23,14 +24,17 @@
 #endif
 
 #include "../cli/cli_options.hpp"
+#include "../cli/config.hpp"
 #include "../io/file_stats.hpp"
 #include "../metrics/timers.hpp"
+#include "../metrics/span_histogram.hpp"
 #include "../metrics/process_stats.hpp"
 #include "../report/emit_run_json.hpp"
 #include "../report/emit_profile_json.hpp"
 #include "../report/emit_dag_json.hpp"
 #include "../report/render_report.hpp"
 #include "../csv/csv_count.hpp"
+#include "../pipeline/fused_scan.hpp"
 
 namespace fs = std::filesystem;
 
@@ -134,20 +138,28 @@ static fs::path find_assets_src() {
     return {}; // not found
 }
 
+// ---------- stages[] rows ----------
+static RunStage stage_from_spans(std::string name, const span_histogram& h) {
+    return RunStage{ std::move(name), h.count(), h.quantile_ms(0.50), h.quantile_ms(0.95),
+                     h.quantile_ms(0.99), h.max_ms(), h.total_ms() };
+}
+
+// a stage timed once, as a whole
+static RunStage stage_once(std::string name, double ms) {
+    return RunStage{ std::move(name), 1, ms, ms, ms, ms, ms };
+}
+
 // ---------- StageTimer (tiny helper for stages[] ----------
 struct StageTimer {
-    std::string   name;
-    std::uint64_t calls = 0;   // ← was int
-    WallTimer     wt{};
-    double        last_ms = 0.0;
+    std::string    name;
+    WallTimer      wt{};
+    span_histogram spans;   // one span per start/stop
 
     explicit StageTimer(const char* n) : name(n ? n : "(stage)") {}
     void start() { wt.start(); }
-    void stop()  { wt.stop(); last_ms = wt.ms(); ++calls; }
+    void stop()  { wt.stop(); spans.add(wt); }
 
-    RunStage as_stage() const {
-        return RunStage{ name, calls, last_ms, last_ms };
-    }
+    RunStage as_stage() const { return stage_from_spans(name, spans); }
 };
 
 // ---------- CPU meter (process % normalized by logical CPUs) ----------
@@ -227,6 +239,8 @@ int main(int argc, char** argv) try {
     if (opt.project_id.empty())
         opt.project_id = gen_project_id();
 
+    const AppConfig cfg = load_config(opt.config);
+
     fs::path input_path = opt.input;
     if (!fs::exists(input_path)) {
         fmt::print(stderr, "ERROR: input not found: {}\n", input_path.string());
@@ -238,7 +252,7 @@ int main(int argc, char** argv) try {
     WallTimer wt_all; wt_all.start();
     const auto started_iso = now_iso_utc();
 
-    // --- stage: count_rows_cols (accurate final counts)
+    // --- CSV dialect
     auto first_char_or = [](const std::string& s, char fallback) -> char {
         return s.empty() ? fallback : s[0];
     };
@@ -248,58 +262,57 @@ int main(int argc, char** argv) try {
 
     std::vector<RunStage> stages;
 
-    StageTimer st_count("count_rows_cols");
-    st_count.start();
-
-    const CsvCounts counts = csv_count_rows_cols(
-        input_path.string(),
-        delim_char,
-        quote_char,
-        static_cast<size_t>(opt.chunk_bytes),
-        header
-    );
-
-    st_count.stop();
-    stages.push_back(st_count.as_stage());
-
-    // --- stage: scan_chunks (timeline samples w/ CPU%)
+    // --- stage: scan_chunks (single fused pass: counts + profile + timeline samples w/ CPU%)
     StageTimer st_scan("scan_chunks");
     st_scan.start();
 
     std::vector<RunSample> samples;
     const std::uint64_t file_bytes = file_size_bytes(input_path);
 
-    std::ifstream in(input_path, std::ios::binary);
-    if (in) {
-        const size_t chunk = std::max<size_t>(1, static_cast<size_t>(opt.chunk_bytes > 0 ? opt.chunk_bytes : (1 << 20)));
-        std::vector<char> buf(chunk);
-        std::uint64_t bytes_in = 0;
-        std::uint64_t rows_in  = 0;
-
+    csvqr::scan_options scan_opt;
+    scan_opt.delimiter   = delim_char;
+    scan_opt.quote       = quote_char;
+    scan_opt.has_header  = header;
+    scan_opt.chunk_bytes = static_cast<size_t>(opt.chunk_bytes);
+    scan_opt.backend     = csvqr::parse_read_backend(opt.io_backend);
+    scan_opt.threads     = opt.threads >= 0 ? opt.threads : cfg.threads;
+    scan_opt.read_ahead  = static_cast<size_t>(opt.read_ahead >= 0 ? opt.read_ahead : cfg.read_ahead);
+    scan_opt.profile.null_tokens      = cfg.null_values;
+    scan_opt.profile.date_formats     = cfg.date_formats;
+    scan_opt.profile.datetime_formats = cfg.datetime_formats;
+    scan_opt.profile.quantiles        = cfg.quantiles;
+    scan_opt.profile.quantile_k       = static_cast<std::uint16_t>(cfg.quantile_k);
+    scan_opt.profile.topk             = static_cast<size_t>(cfg.topk);
+    scan_opt.profile.hll_precision    = static_cast<unsigned>(cfg.hll_precision);
+    scan_opt.profile.hist_bins        = cfg.hist_bins;
+    scan_opt.profile.include_columns  = cfg.include_columns;
+    scan_opt.profile.exclude_columns  = cfg.exclude_columns;
+    scan_opt.profile.forced_types     = cfg.forced_types;
+    // an explicit --sample-frac wins over [sampling]; 1 forces the exact scan
+    scan_opt.sample_frac     = opt.sample_frac >= 0.0 ? opt.sample_frac : (cfg.sampling ? cfg.sample_frac : 0.0);
+    scan_opt.max_sample_rows = static_cast<std::uint64_t>(cfg.max_sample_rows);
+    if (cfg.cache && !opt.no_cache)
+        scan_opt.cache_dir = fs::path(opt.output_root) / ".cache";
+    scan_opt.incremental = cfg.incremental;
+    scan_opt.sidecar_index = cfg.row_index;
+
+    csvqr::fused_scan scan(input_path, scan_opt);
+    {
         WallTimer wt_scan_clock; wt_scan_clock.start();
         CpuMeter cpu; cpu.begin();
 
-        while (in) {
-            in.read(buf.data(), static_cast<std::streamsize>(buf.size()));
-            const std::streamsize got = in.gcount();
-            if (got <= 0) break;
-
-            bytes_in += static_cast<std::uint64_t>(got);
-
-            // quick newline-based row approximation for timeline only
-            const char* p = buf.data();
-            for (std::streamsize i = 0; i < got; ++i) {
-                if (p[i] == '\n') ++rows_in;
-            }
-
+        while (scan.next() > 0) {
+            wt_scan_clock.stop();
             const std::uint64_t ts_ms = static_cast<std::uint64_t>(wt_scan_clock.ms());
             const double rss_now = process_rss_mb();
             const double cpu_pct = cpu.sample();
 
+            // rows_in is exact here: it comes from the quote-aware counter
+            // (a sampled run reports the records it profiled)
             samples.push_back(RunSample{
                 ts_ms,
-                bytes_in,
-                rows_in,
+                scan.bytes_in(),
+                scan.rows_so_far(),
                 rss_now,
                 cpu_pct
             });
@@ -307,15 +320,63 @@ int main(int argc, char** argv) try {
 
         // Ensure a final sample at EOF
         if (!samples.empty() && samples.back().bytes_in < file_bytes) {
+            wt_scan_clock.stop();
             const std::uint64_t ts_ms = static_cast<std::uint64_t>(wt_scan_clock.ms());
             const double rss_now = process_rss_mb();
             const double cpu_pct_final = cpu.sample();  // <— get a reading
-            samples.push_back(RunSample{ ts_ms, file_bytes, rows_in, rss_now, cpu_pct_final });
+            samples.push_back(RunSample{ ts_ms, file_bytes, scan.rows_so_far(), rss_now, cpu_pct_final });
         }
     }
 
+    const CsvCounts counts = scan.counts();
+    const csvqr::ProfileResult profile = scan.finish();
+    if (scan.cache_store_failed())
+        fmt::print(stderr, "WARN: could not write the profile cache under {}\n", scan_opt.cache_dir.string());
+    if (scan.index_built() && !scan.index_stored())
+        fmt::print(stderr, "WARN: could not write the row index {}\n", csvqr::sidecar_index_path(input_path).string());
+    for (const auto& name : cfg.include_columns) {
+        const bool found = std::any_of(profile.columns.begin(), profile.columns.end(),
+                                       [&](const csvqr::ColumnSummary& c){ return c.name == name; });
+        if (!found) fmt::print(stderr, "WARN: [columns] include: no column named '{}'\n", name);
+    }
+
     st_scan.stop();
+
+    // --- optional: columnar snapshot for later runs (a second pass over the input)
+    std::optional<RunStage> snapshot_stage;
+    if (!opt.snapshot.empty()) {
+        const char* refused =
+            scan.from_snapshot()                ? "the input is already a snapshot"
+          : scan.sampled()                      ? "the run was sampled"
+          : !fs::is_regular_file(input_path)    ? "the input is not a regular file"
+          : !cfg.include_columns.empty() || !cfg.exclude_columns.empty() ? "[columns] selects a subset"
+          : !cfg.forced_types.empty()           ? "[types] force is set"
+          : nullptr;
+        StageTimer st_snap("write_snapshot");
+        st_snap.start();
+        if (refused)
+            fmt::print(stderr, "WARN: not writing the snapshot: {}\n", refused);
+        else if (!csvqr::write_snapshot(input_path, opt.snapshot, delim_char, quote_char, header,
+                                        scan_opt.profile, profile, counts))
+            fmt::print(stderr, "WARN: could not write the snapshot {}\n", opt.snapshot);
+        st_snap.stop();
+        if (!refused) snapshot_stage = st_snap.as_stage();
+    }
+
+    // consumers of the fused pass, reported as their own stages with one span
+    // per chunk, batch, range or column (see fused_scan::profile_spans);
+    // tokenize_csv and type_infer split profile_columns
+    if (scan.read_spans().count()) stages.push_back(stage_from_spans("read_chunks", scan.read_spans()));
+    stages.push_back(stage_from_spans("count_rows_cols", scan.count_spans()));   // calls 0 on a cache hit
+    if (scan.tokenize_spans().count()) stages.push_back(stage_from_spans("tokenize_csv", scan.tokenize_spans()));
+    if (scan.kernel_spans().count()) stages.push_back(stage_from_spans("type_infer", scan.kernel_spans()));
+    if (scan.profile_spans().count()) stages.push_back(stage_from_spans("profile_columns", scan.profile_spans()));
+    if (scan.cache_hit_pct())
+        stages.push_back(stage_once("profile_cache", scan.cache_ms()));
+    if (scan.index_used() || scan.index_built())
+        stages.push_back(stage_once(scan.index_used() ? "load_index" : "build_index", scan.index_ms()));
     stages.push_back(st_scan.as_stage());
+    if (snapshot_stage) stages.push_back(*snapshot_stage);
 
     // --- finalize run stats
     wt_all.stop();
@@ -332,19 +393,30 @@ int main(int argc, char** argv) try {
     const fs::path report_html   = out_dir / "report.html";
 
     // --- emit JSON artifacts
+    RunIo io;
+    io.backend    = scan.uses_io_uring() ? "async-io_uring" : csvqr::to_string(scan.backend());
+    io.read_ahead = scan.backend() == csvqr::read_backend::async ? scan_opt.read_ahead : 0;
+    io.wait_ms    = scan.io_wait_ms();
+    io.parse_ms   = scan.count_ms() + scan.profile_ms();
+
+    // share of profiled cells whose verdict came from the per-column memo
+    std::optional<double> memo_hit_pct;
+    if (profile.memo_lookups > 0)
+        memo_hit_pct = 100.0 * static_cast<double>(profile.memo_hits) / static_cast<double>(profile.memo_lookups);
+    const RunArena arena{ profile.scratch_arena_bytes, profile.key_arena_bytes, profile.interned_keys };
     emit_run_json(run_json.string(), started_iso, ended_iso, wall_ms, file_bytes, counts.rows,
-                  stages, samples, /*rss_peak_mb*/ rss_peak, /*cpu_user_pct*/ 0.0, /*cpu_sys_pct*/ 0.0);
+                  stages, samples, /*rss_peak_mb*/ rss_peak, /*cpu_user_pct*/ 0.0, /*cpu_sys_pct*/ 0.0, io,
+                  scan.cache_hit_pct(), memo_hit_pct, arena);
 
-    // keep profile minimal for now; step 2 will fill real column data
-    csvqr::emit_profile_json_scan_file(
+    csvqr::emit_profile_json(
         profile_json.string(),
         input_path.string(),
-        /*rows_hint*/ counts.rows,
-        delim_char,
-        quote_char,
-        header
+        profile.rows,
+        scan.header_present(),
+        profile.columns,
+        profile.sample
     );
-    emit_dag_json(dag_json.string());
+    emit_dag_json(dag_json.string(), stages);
 
     // --- copy report assets (JS/CSS/vendor) next to report.html
     {
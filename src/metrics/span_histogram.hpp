@@ -0,0 +1,81 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <limits>
+
+#include "timers.hpp"
+
+// Latency distribution of one stage: every span (a chunk, a batch, a range)
+// lands in a fixed log-bucketed histogram, so recording is a few integer ops
+// and no allocation however many spans a run takes. Buckets split each power
+// of two of nanoseconds into 8, so a quantile is off by at most 1/16 of its
+// value (bucket midpoint); count, total and max are exact, and a quantile of
+// a single span is that span.
+class span_histogram {
+public:
+    void add_ns(std::uint64_t ns) noexcept {
+        ++buckets_[bucket(ns)];
+        ++count_;
+        total_ns_ += ns;
+        min_ns_ = std::min(min_ns_, ns);
+        max_ns_ = std::max(max_ns_, ns);
+    }
+    void add(const WallTimer& t) noexcept { add_ns(t.ns()); }
+
+    void merge(const span_histogram& o) noexcept {
+        for (std::size_t i = 0; i < buckets_.size(); ++i) buckets_[i] += o.buckets_[i];
+        count_    += o.count_;
+        total_ns_ += o.total_ns_;
+        min_ns_ = std::min(min_ns_, o.min_ns_);
+        max_ns_ = std::max(max_ns_, o.max_ns_);
+    }
+
+    std::uint64_t count()    const noexcept { return count_; }
+    std::uint64_t total_ns() const noexcept { return total_ns_; }
+    double total_ms() const noexcept { return static_cast<double>(total_ns_) / 1e6; }
+    double max_ms()   const noexcept { return static_cast<double>(max_ns_) / 1e6; }
+
+    // Span at rank ceil(q * count), as its bucket's midpoint clamped to the
+    // observed range; 0 when empty.
+    double quantile_ms(double q) const noexcept {
+        if (count_ == 0) return 0.0;
+        const double want = std::clamp(q, 0.0, 1.0) * static_cast<double>(count_);
+        std::uint64_t rank = static_cast<std::uint64_t>(want);
+        if (static_cast<double>(rank) < want || rank == 0) ++rank;
+        std::uint64_t seen = 0;
+        std::size_t b = 0;
+        for (; b + 1 < buckets_.size(); ++b) {
+            seen += buckets_[b];
+            if (seen >= rank) break;
+        }
+        const std::uint64_t lo = lower(b), hi = b + 1 < buckets_.size() ? lower(b + 1) : lo;
+        const std::uint64_t mid = lo + (hi - lo) / 2;
+        return static_cast<double>(std::clamp(mid, min_ns_, max_ns_)) / 1e6;
+    }
+
+private:
+    static constexpr int sub_bits = 3;                    // 8 buckets per power of two
+    static constexpr std::size_t sub = std::size_t{1} << sub_bits;
+    static constexpr std::size_t n_buckets = sub + (64 - sub_bits) * sub;
+
+    static std::size_t bucket(std::uint64_t ns) noexcept {
+        if (ns < sub) return static_cast<std::size_t>(ns);
+        const int e = 63 - std::countl_zero(ns);          // >= sub_bits
+        const std::size_t frac = static_cast<std::size_t>(ns >> (e - sub_bits)) & (sub - 1);
+        return sub + static_cast<std::size_t>(e - sub_bits) * sub + frac;
+    }
+    // Smallest span that lands in bucket b.
+    static std::uint64_t lower(std::size_t b) noexcept {
+        if (b < sub) return b;
+        const std::size_t e = (b - sub) / sub + sub_bits, frac = (b - sub) % sub;
+        return (std::uint64_t{1} << e) | (static_cast<std::uint64_t>(frac) << (e - sub_bits));
+    }
+
+    std::array<std::uint64_t, n_buckets> buckets_{};
+    std::uint64_t count_    = 0;
+    std::uint64_t total_ns_ = 0;
+    std::uint64_t min_ns_   = std::numeric_limits<std::uint64_t>::max();
+    std::uint64_t max_ns_   = 0;
+};
@@ -1,5 +1,6 @@
 #pragma once
 #include <chrono>
+#include <cstdint>
 
 struct WallTimer {
     using clock = std::chrono::steady_clock;
@@ -7,4 +8,8 @@ struct WallTimer {
     void start() { t0 = clock::now(); }
     void stop()  { t1 = clock::now(); }
     double ms() const { return std::chrono::duration<double,std::milli>(t1 - t0).count(); }
+    std::uint64_t ns() const {
+        const auto d = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+        return d > 0 ? static_cast<std::uint64_t>(d) : 0;
+    }
 };
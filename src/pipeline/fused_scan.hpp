@@ -0,0 +1,492 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../csv/csv_count.hpp"
+#include "../csv/parallel_count.hpp"
+#include "../csv/record_splitter.hpp"
+#include "../csv/row_index.hpp"
+#include "../io/chunk_reader.hpp"
+#include "../metrics/span_histogram.hpp"
+#include "../metrics/timers.hpp"
+#include "../profile/parallel_profile.hpp"
+#include "../profile/profile.hpp"
+#include "../profile/sample_profile.hpp"
+#include "../util/serial.hpp"
+#include "profile_cache.hpp"
+#include "sidecar_index.hpp"
+#include "snapshot.hpp"
+
+namespace csvqr {
+
+struct scan_options {
+    char        delimiter   = ',';
+    char        quote       = '"';
+    bool        has_header  = true;
+    std::size_t chunk_bytes = 262144;
+    read_backend backend    = read_backend::automatic;
+    int         threads     = 1;        // counting/profiling threads; 0 = all cores
+    std::size_t read_ahead  = 4;        // async backend ring depth
+    profile_options profile;            // null tokens, date formats, batch size
+    double        sample_frac     = 0.0;    // in (0, 1): profile random blocks instead (mapped inputs)
+    std::uint64_t max_sample_rows = 0;      // sampling stops after this many rows; 0 = no cap
+    std::filesystem::path cache_dir;        // profile cache (exact scans of regular files); empty = off
+    bool          incremental     = true;   // with a cache: resume from the saved state of a prefix
+    bool          sidecar_index   = false;  // use / build the row index next to the input
+    std::size_t   index_block     = 1u << 20; // row index granularity (bytes per block)
+};
+
+// Everything that changes what a scan produces, hashed: saved scan state is
+// only reused under the same fingerprint. Threads, backend and chunk size do
+// not change results beyond sketch bounds and are left out.
+inline std::uint64_t options_fingerprint(const scan_options& o) {
+    byte_writer w;
+    w.put(o.delimiter);
+    w.put(o.quote);
+    w.put(o.has_header);
+    const profile_options& p = o.profile;
+    auto strings = [&](const std::vector<std::string>& v){
+        w.put<std::uint64_t>(v.size());
+        for (const auto& x : v) w.put_str(x);
+    };
+    strings(p.null_tokens);
+    strings(p.date_formats);
+    strings(p.datetime_formats);
+    w.put_vec(p.quantiles);
+    w.put(p.quantile_k);
+    w.put(p.hist_bins);
+    w.put<std::uint64_t>(p.topk);
+    w.put<std::uint64_t>(p.topk_counters);
+    w.put(p.hll_precision);
+    strings(p.include_columns);
+    strings(p.exclude_columns);
+    w.put<std::uint64_t>(p.forced_types.size());
+    for (const auto& [col, type] : p.forced_types) { w.put_str(col); w.put_str(type); }
+    return hash64(w.bytes());
+}
+
+// Single-pass engine: every chunk is read once (a zero-copy window when the
+// input is memory-mapped) and handed, while hot in cache, to the row/column
+// counter and to the record splitter feeding the column profiler. The caller
+// drives the loop, one next() per chunk, and takes timeline samples between.
+//
+//   fused_scan scan(path, opts);
+//   while (scan.next()) { /* sample scan.bytes_in(), scan.rows_so_far() */ }
+//   CsvCounts counts = scan.counts();
+//   ProfileResult profile = scan.finish();
+class fused_scan {
+public:
+    fused_scan(const std::filesystem::path& path, const scan_options& opt)
+        : fused_scan(path, opt, consult_cache(path, opt)) {}
+
+    // Reads the next chunk and runs all consumers over it; 0 = EOF.
+    std::size_t next() {
+        WallTimer t;
+        if (chunks_ == 0 && from_cache_) {
+            // the whole input, as one chunk
+            bytes_in_ = input_->size;
+            chunks_   = 1;
+            return static_cast<std::size_t>(input_->size);
+        }
+        if (whole_counts_) return 0;
+        if (chunks_ == 0 && reused_bytes_ == 0 && is_snapshot()) return run_snapshot();
+        if (chunks_ == 0 && sampling(opt_) && reader_.is_mapped()) {
+            if (const std::size_t got = run_sampled(reader_.mapped())) return got;
+        }
+        if (chunks_ == 0 && !index_checked_ && opt_.sidecar_index && reused_bytes_ == 0) load_index();
+        if (chunks_ == 0 && reused_bytes_ == 0 && opt_.threads != 1 && reader_.is_mapped()) {
+            const std::string_view data = reader_.mapped();
+            const std::size_t parts = parallel_parts(data.size(), opt_.threads);
+            if (parts > 1) return run_parallel(data, parts);
+        }
+
+        t.start();
+        const std::string_view chunk = reader_.next();
+        t.stop();
+        const std::size_t got = chunk.size();
+        if (got == 0) return 0;
+        read_spans_.add(t);
+        bytes_in_ += got;
+        last_byte_ = chunk.back();
+
+        t.start();
+        if (builder_) builder_->feed(counter_, chunk);
+        else if (!index_) counter_.feed(chunk);
+        t.stop();
+        count_ms_ += t.ms();
+        count_spans_.add(t);
+
+        const std::uint64_t kernel_before = profiler_.kernel_spans().total_ns();
+        t.start();
+        profiler_.begin_chunk(chunk);
+        splitter_.feed(chunk, [&](std::string_view rec){ profiler_.add_record(rec); ++records_; });
+        profiler_.end_batch();
+        t.stop();
+        profile_ms_ += t.ms();
+        add_profile_span(t.ns(), profiler_.kernel_spans().total_ns() - kernel_before);
+
+        ++chunks_;
+        return got;
+    }
+
+    std::uint64_t bytes_in()    const noexcept { return bytes_in_; }
+    std::uint64_t chunks()      const noexcept { return chunks_; }
+    // complete records seen so far (header included)
+    std::uint64_t rows_so_far() const noexcept { return records_; }
+    double        count_ms()    const noexcept { return count_ms_; }
+    double        profile_ms()  const noexcept { return profile_ms_; }
+    // Latency distributions, one span per unit of work: a chunk (sequential
+    // scan), a range (parallel scan), a column (snapshot), the whole call
+    // (sampling) or a trailing record flushed by finish(). Spans of
+    // concurrent units add up in the totals, unlike count_ms/profile_ms,
+    // which are wall time. tokenize_spans are the
+    // profile spans less the kernel time inside them; kernel_spans are the
+    // type kernels themselves, one span per batch.
+    const span_histogram& read_spans()     const noexcept { return read_spans_; }
+    const span_histogram& count_spans()    const noexcept { return count_spans_; }
+    const span_histogram& tokenize_spans() const noexcept { return tokenize_spans_; }
+    const span_histogram& kernel_spans()   const noexcept { return profiler_.kernel_spans(); }
+    const span_histogram& profile_spans()  const noexcept { return profile_spans_; }
+    read_backend  backend()     const noexcept { return reader_.backend(); }
+    // time blocked waiting for input (see chunk_reader::io_wait_ms)
+    double        io_wait_ms()  const noexcept { return reader_.io_wait_ms(); }
+    bool          uses_io_uring() const noexcept { return reader_.uses_io_uring(); }
+
+    CsvCounts counts() const {
+        if (whole_counts_) return *whole_counts_;
+        return index_ ? index_->counts(opt_.has_header) : counter_.finish(opt_.has_header);
+    }
+
+    // Flushes the trailing record (if any) and finalizes the column profile;
+    // with a cache_dir, a scan that read its input saves its state.
+    ProfileResult finish() {
+        if (sampled_profile_) return *sampled_profile_;
+        // before the flush: a trailing partial record cannot be resumed
+        const bool resumable = last_byte_ == '\n' &&
+                               (whole_counts_ ? parallel_at_line_start_
+                                              : index_ ? index_->terminated : counter_.at_line_start);
+        const std::uint64_t kernel_before = profiler_.kernel_spans().total_ns(), records_before = records_;
+        WallTimer t;
+        t.start();
+        splitter_.finish([&](std::string_view rec){ profiler_.add_record(rec); ++records_; });
+        ProfileResult pr = profiler_.finish();
+        t.stop();
+        profile_ms_ += t.ms();
+        // a span only if a trailing record was actually tokenized here
+        if (records_ > records_before && !from_cache_ && !from_snapshot_)
+            add_profile_span(t.ns(), profiler_.kernel_spans().total_ns() - kernel_before);
+        if (input_ && !from_cache_) {
+            t.start();
+            store_state(resumable);
+            t.stop();
+            cache_ms_ += t.ms();
+        }
+        if (builder_) {
+            t.start();
+            if (!built_index_) built_index_ = builder_->finish(counter_);
+            index_stored_ = index_fp_ && built_index_->size == index_fp_->size &&
+                            store_sidecar_index(path_, *index_fp_, opt_.delimiter, opt_.quote, *built_index_);
+            t.stop();
+            index_ms_ += t.ms();
+        }
+        return pr;
+    }
+
+    // Set when the profile (and the row count) came from a sample.
+    bool sampled() const noexcept { return sampled_profile_.has_value(); }
+    // Set when the input was a columnar snapshot rather than CSV.
+    bool from_snapshot() const noexcept { return from_snapshot_; }
+    // Whether the CSV had a header row (a snapshot records its writer's setting).
+    bool header_present() const noexcept { return from_snapshot_ ? snapshot_header_ : opt_.has_header; }
+
+    // Share of the input whose scan state came from the cache: 100 on a hit,
+    // the reused prefix on a resumed scan, 0 on a miss; nullopt when the
+    // cache was not consulted.
+    std::optional<double> cache_hit_pct() const {
+        if (!input_) return std::nullopt;
+        if (from_cache_ || input_->size == 0) return from_cache_ ? 100.0 : 0.0;
+        return 100.0 * static_cast<double>(reused_bytes_) / static_cast<double>(input_->size);
+    }
+    // time spent looking up, loading and storing cached state
+    double cache_ms()     const noexcept { return cache_ms_; }
+    // true if a scan that read input could not save its state (unwritable cache directory)
+    bool   cache_store_failed() const noexcept { return input_ && !from_cache_ && !cache_stored_; }
+
+    // Row index: used = a matching sidecar replaced the count pass; built = this
+    // scan recorded one (index_stored: and wrote it). index_ms is the time
+    // spent loading, or assembling and writing it.
+    bool   index_used()   const noexcept { return index_.has_value(); }
+    bool   index_built()  const noexcept { return builder_.has_value(); }
+    bool   index_stored() const noexcept { return index_stored_; }
+    double index_ms()     const noexcept { return index_ms_; }
+
+private:
+    // What the cache holds for this input, looked up before the reader opens
+    // so that a resumed scan starts reading where the saved state ends.
+    struct prior_scan {
+        std::optional<input_fingerprint> input;      // set when the cache was consulted
+        std::optional<cached_scan>       scan;       // exact hit or verified prefix
+        std::optional<column_profiler>   profiler;   // scan->state, loaded
+        bool                             exact = false;
+        double                           ms    = 0.0;
+    };
+
+    static bool sampling(const scan_options& o) noexcept { return o.sample_frac > 0.0 && o.sample_frac < 1.0; }
+
+    // With a cache_dir, an exact scan of a regular file first looks up the
+    // state of a previous scan (see profile_cache): on a hit the first next()
+    // reads nothing and finish() renders the loaded accumulators; a miss
+    // stores the state at finish(). With incremental, a verified prefix is
+    // taken too and the scan resumes from it. Sampled runs skip the cache.
+    static prior_scan consult_cache(const std::filesystem::path& path, const scan_options& opt) {
+        prior_scan p;
+        if (opt.cache_dir.empty() || sampling(opt)) return p;
+        WallTimer t;
+        t.start();
+        p.input = fingerprint_input(path);
+        if (p.input) {
+            const profile_cache cache(opt.cache_dir);
+            const std::uint64_t key = options_fingerprint(opt);
+            p.scan  = cache.load(*p.input, key);
+            p.exact = p.scan.has_value();
+            if (!p.scan && opt.incremental) p.scan = cache.load_prefix(*p.input, key);
+        }
+        if (p.scan) {
+            try {
+                byte_reader r(p.scan->state);
+                p.profiler.emplace(opt.delimiter, opt.quote, opt.has_header, opt.profile);
+                p.profiler->load(r);
+            } catch (const std::runtime_error&) {
+                // unreadable state: scan from scratch
+                p.scan.reset();
+                p.profiler.reset();
+                p.exact = false;
+            }
+        }
+        t.stop();
+        p.ms = t.ms();
+        return p;
+    }
+
+    // A resumed scan (the file only grew since its state was saved) starts
+    // reading at the old end; the counter and the profiler continue from the
+    // saved state, so only the appended bytes are tokenized, sequentially.
+    // bytes_in() counts the reused prefix.
+    fused_scan(const std::filesystem::path& path, const scan_options& opt, prior_scan prior)
+        : opt_(opt),
+          path_(path),
+          reader_(path, opt.chunk_bytes > 0 ? opt.chunk_bytes : 262144, opt.backend, opt.read_ahead,
+                  prior.scan && !prior.exact ? prior.scan->bytes : 0),
+          counter_(opt.delimiter, opt.quote),
+          splitter_(opt.quote),
+          profiler_(prior.profiler ? std::move(*prior.profiler)
+                                   : column_profiler(opt.delimiter, opt.quote, opt.has_header, opt.profile)),
+          input_(std::move(prior.input)),
+          cache_ms_(prior.ms)
+    {
+        if (!prior.scan) return;
+        const cached_scan& s = *prior.scan;
+        records_ = s.records;
+        if (prior.exact) {
+            from_cache_   = true;
+            whole_counts_ = s.counts;
+            return;
+        }
+        // resume: the prefix ended with '\n' outside quotes, so the counter
+        // only needs its totals back (every physical row is a record there)
+        counter_.rows           = s.records;
+        counter_.first_row_done = s.records > 0;
+        counter_.first_row_cols = s.counts.columns;
+        reused_bytes_ = bytes_in_ = s.bytes;
+        last_byte_    = '\n';
+    }
+
+    // With sidecar_index, a scan that reads a regular file from its start
+    // uses the row index next to it (see sidecar_index.hpp) when it matches
+    // the bytes: counts come from it and a parallel run cuts at its record
+    // starts. Otherwise the count pass builds one (row_index_builder, or the
+    // speculative pass's marks) and finish() writes it for the next run.
+    void load_index() {
+        index_checked_ = true;
+        WallTimer t;
+        t.start();
+        index_fp_ = input_ ? input_ : fingerprint_input(path_);
+        if (index_fp_) {
+            index_ = load_sidecar_index(path_, *index_fp_, opt_.delimiter, opt_.quote);
+            if (!index_) builder_.emplace(opt_.index_block);
+        }
+        t.stop();
+        index_ms_ += t.ms();
+    }
+
+    // Saves counts and accumulators under the fingerprint of the bytes read.
+    void store_state(bool resumable) {
+        input_fingerprint in = *input_;
+        if (bytes_in_ != in.size) {
+            // the file changed size while it was read (a writer appending):
+            // describe the bytes actually scanned
+            const auto content = content_fingerprint(path_, bytes_in_);
+            if (!content) return;
+            in.size    = bytes_in_;
+            in.content = *content;
+        }
+        byte_writer w;
+        profiler_.save(w);
+        cached_scan s;
+        s.counts    = counts();
+        s.records   = records_;
+        s.resumable = resumable;
+        s.state     = w.take();
+        cache_stored_ = profile_cache(opt_.cache_dir).store(in, options_fingerprint(opt_), s);
+    }
+
+    // With 0 < sample_frac < 1 the first next() profiles randomly placed
+    // blocks of the mapping (profile_sampled) and estimates the row count from
+    // them, returning the whole size in one call. 0 if the input is not worth
+    // sampling; the caller then scans it all.
+    std::size_t run_sampled(std::string_view data) {
+        WallTimer t;
+        t.start();
+        sample_options so;
+        so.fraction = opt_.sample_frac;
+        so.max_rows = opt_.max_sample_rows;
+        so.block_bytes = opt_.chunk_bytes > 0 ? opt_.chunk_bytes : so.block_bytes;
+        auto sr = profile_sampled(data, opt_.delimiter, opt_.quote, opt_.has_header, opt_.profile, so);
+        t.stop();
+        profile_ms_ += t.ms();
+        profile_spans_.add(t);
+        if (!sr) return 0;
+
+        // The width comes from the first record, as csv_counter's does.
+        record_tokenizer tok(opt_.delimiter, opt_.quote);
+        record_view view;
+        arena scratch(4096);
+        tok.tokenize(data.substr(0, detail::record_end(data, 0, opt_.quote)), view, scratch);
+        whole_counts_ = CsvCounts{sr->profile.rows, static_cast<std::uint32_t>(view.size())};
+
+        sampled_profile_ = std::move(sr->profile);
+        records_  = sr->records;
+        bytes_in_ = data.size();
+        chunks_   = 1;
+        return data.size();
+    }
+
+    bool is_snapshot() const {
+        return reader_.is_mapped() ? is_snapshot_bytes(reader_.mapped()) : is_snapshot_file(path_);
+    }
+
+    // A columnar snapshot (see snapshot.hpp), recognized by its magic, is
+    // profiled column by column, threads at a time, instead of tokenized, in
+    // one next() call. The cache still applies; sampling and the row index
+    // do not.
+    std::size_t run_snapshot() {
+        WallTimer t;
+        t.start();
+        if (!reader_.is_mapped() && !snapshot_map_.open(path_))
+            throw std::runtime_error("cannot map snapshot " + path_.string());
+        const std::string_view data = reader_.is_mapped() ? reader_.mapped() : snapshot_map_.view();
+        const snapshot_file snap(data);   // the counts come with its directory
+        t.stop();
+        count_ms_ += t.ms();
+        count_spans_.add(t);
+
+        t.start();
+        profile_snapshot(snap, profiler_, opt_.threads, &profile_spans_);
+        t.stop();
+        profile_ms_ += t.ms();
+
+        whole_counts_    = snap.counts();
+        from_snapshot_   = true;
+        snapshot_header_ = snap.has_header();
+        records_   = snap.rows() + (snap.has_header() ? 1 : 0);
+        bytes_in_  = data.size();
+        last_byte_ = data.back();
+        chunks_    = 1;
+        return data.size();
+    }
+
+    void add_profile_span(std::uint64_t ns, std::uint64_t kernel_ns) {
+        profile_spans_.add_ns(ns);
+        tokenize_spans_.add_ns(ns > kernel_ns ? ns - kernel_ns : 0);
+    }
+
+    // threads != 1 on a mapping of at least 1 MiB per thread: the speculative
+    // counter (or a row index) cuts the input into ranges at record starts,
+    // each range is profiled on its own thread and the profiles are merged
+    // (exact counts and types; sketches within their bounds). Returns the
+    // file size, so the caller gets a single timeline sample.
+    std::size_t run_parallel(std::string_view data, std::size_t parts) {
+        WallTimer t;
+        std::vector<std::size_t> starts;
+        t.start();
+        if (index_ && index_->size == data.size()) {
+            whole_counts_ = index_->counts(opt_.has_header);
+            parallel_at_line_start_ = index_->terminated;
+            starts = index_->record_starts(data, parts, opt_.quote);
+        } else {
+            const speculative_scan sc = scan_speculative(data, opt_.delimiter, opt_.quote, parts,
+                                                         count_kernel::automatic,
+                                                         builder_ ? opt_.index_block : 0);
+            whole_counts_ = sc.counts(opt_.has_header);
+            parallel_at_line_start_ = sc.at_line_start();
+            starts = sc.record_starts(data, opt_.quote);
+            if (builder_) built_index_ = make_row_index(sc, opt_.index_block, data.size());
+        }
+        t.stop();
+        count_ms_ += t.ms();
+        count_spans_.add(t);
+
+        range_timings rt;
+        t.start();
+        records_ = profile_parallel_into(profiler_, data, starts, opt_.delimiter, opt_.quote,
+                                         opt_.has_header, opt_.profile, &rt);
+        t.stop();
+        profile_ms_ += t.ms();
+        for (std::size_t i = 0; i < rt.total_ns.size(); ++i)
+            if (rt.total_ns[i] > 0) add_profile_span(rt.total_ns[i], rt.kernel_ns[i]);
+
+        bytes_in_  = data.size();
+        last_byte_ = data.back();
+        chunks_    = 1;
+        return data.size();
+    }
+
+    scan_options    opt_;
+    std::filesystem::path path_;
+    chunk_reader    reader_;
+    csv_counter     counter_;
+    record_splitter splitter_;
+    column_profiler profiler_;
+
+    std::optional<CsvCounts>     whole_counts_;      // the first next() did the whole input
+    std::optional<ProfileResult> sampled_profile_;
+    std::optional<input_fingerprint> input_;         // set when the cache was consulted
+    double        cache_ms_     = 0.0;
+    bool          from_cache_   = false;
+    bool          from_snapshot_ = false;
+    bool          snapshot_header_ = false;
+    mapped_file   snapshot_map_;                     // snapshot read through a non-mapping backend
+    bool          cache_stored_ = false;
+    std::uint64_t reused_bytes_ = 0;                 // resumed: prefix covered by the saved state
+    char          last_byte_    = 0;
+    bool          parallel_at_line_start_ = false;
+    std::optional<input_fingerprint> index_fp_;      // the bytes the row index describes
+    std::optional<row_index>         index_;         // a matching sidecar
+    std::optional<row_index_builder> builder_;       // no usable sidecar: build one
+    std::optional<row_index>         built_index_;   // parallel pass: assembled from its marks
+    bool          index_checked_ = false;
+    bool          index_stored_  = false;
+    double        index_ms_      = 0.0;
+    std::uint64_t records_  = 0;
+    std::uint64_t bytes_in_ = 0;
+    std::uint64_t chunks_   = 0;
+    double        count_ms_ = 0.0;
+    double        profile_ms_ = 0.0;
+    span_histogram read_spans_, count_spans_, tokenize_spans_, profile_spans_;
+};
+
+}
@@ -0,0 +1,188 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include "../csv/csv_count.hpp"
+#include "../util/hash.hpp"
+#include "../util/serial.hpp"
+
+namespace csvqr {
+
+// Identity of an input file as seen by one run.
+struct input_fingerprint {
+    std::string   path;          // absolute, normalized
+    std::uint64_t size    = 0;
+    std::int64_t  mtime   = 0;   // file clock ticks
+    std::uint64_t content = 0;   // content_fingerprint(path, size)
+};
+
+// Cheap content check: the hash of up to 16 blocks of 4 KiB spread evenly
+// over the first `size` bytes (first and last block included), so at most
+// 64 KiB is read whatever the file size. Catches rewrites that keep size and
+// mtime (restored backups, copies with preserved timestamps); a change that
+// misses every block goes unnoticed. nullopt if the bytes cannot be read.
+inline std::optional<std::uint64_t> content_fingerprint(const std::filesystem::path& path, std::uint64_t size) {
+    constexpr std::uint64_t block = 4096, blocks = 16;
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return std::nullopt;
+    std::uint64_t h = hash64(std::string_view(reinterpret_cast<const char*>(&size), sizeof size));
+    std::string buf(block, '\0');
+    const std::uint64_t n = size <= block * blocks ? (size + block - 1) / block : blocks;
+    for (std::uint64_t i = 0; i < n; ++i) {
+        const std::uint64_t off = n == 1 ? 0 : (size - std::min(size, block)) * i / (n - 1);
+        const std::uint64_t len = std::min(block, size - off);
+        in.seekg(static_cast<std::streamoff>(off));
+        if (!in.read(buf.data(), static_cast<std::streamsize>(len))) return std::nullopt;
+        h = mul_fold64(h ^ hash64(std::string_view(buf.data(), static_cast<std::size_t>(len))), 0x9E3779B97F4A7C15ull);
+    }
+    return h;
+}
+
+// nullopt for anything that is not a readable regular file (pipes, devices).
+inline std::optional<input_fingerprint> fingerprint_input(const std::filesystem::path& path) {
+    std::error_code ec;
+    if (!std::filesystem::is_regular_file(path, ec)) return std::nullopt;
+    input_fingerprint fp;
+    fp.path = std::filesystem::absolute(path, ec).lexically_normal().string();
+    if (ec) return std::nullopt;
+    fp.size = std::filesystem::file_size(path, ec);
+    if (ec) return std::nullopt;
+    const auto t = std::filesystem::last_write_time(path, ec);
+    if (ec) return std::nullopt;
+    fp.mtime = static_cast<std::int64_t>(t.time_since_epoch().count());
+    const auto content = content_fingerprint(path, fp.size);
+    if (!content) return std::nullopt;
+    fp.content = *content;
+    return fp;
+}
+
+// What a finished scan leaves behind: the counts and the profiler's
+// accumulators (column_profiler::save), not the rendered profile, so a hit
+// can be finished, or extended by the bytes appended since, like a fresh scan.
+struct cached_scan {
+    CsvCounts     counts;
+    std::uint64_t records   = 0;      // logical records, header included
+    std::uint64_t bytes     = 0;      // input bytes the state covers (set by load)
+    bool          resumable = false;  // the bytes end with '\n' outside quotes
+    std::string   state;              // column_profiler::save bytes
+};
+
+// On-disk cache of scan results, one entry per input path under `dir`
+// (typically <output root>/.cache). load() uses an entry only if the path,
+// size, mtime, content fingerprint and options fingerprint all match what was
+// stored; load_prefix() accepts a resumable entry whose bytes are still the
+// start of a file that has grown since. Anything else (stale, truncated,
+// other version) is a miss. Entries are written to a temporary file and
+// renamed into place, so an interrupted run never leaves half an entry behind.
+class profile_cache {
+public:
+    static constexpr std::uint32_t format_version = 2;
+
+    explicit profile_cache(std::filesystem::path dir) : dir_(std::move(dir)) {}
+
+    const std::filesystem::path& dir() const noexcept { return dir_; }
+
+    std::optional<cached_scan> load(const input_fingerprint& in, std::uint64_t options) const {
+        auto e = read_entry(in.path);
+        if (!e || e->options != options || e->input.size != in.size || e->input.mtime != in.mtime ||
+            e->input.content != in.content)
+            return std::nullopt;
+        return std::move(e->scan);
+    }
+
+    // Append-only inputs: the saved state of a scan that ended on a record
+    // boundary, if the file still starts with the bytes it covered (same
+    // content fingerprint over the old size). The caller scans the rest.
+    std::optional<cached_scan> load_prefix(const input_fingerprint& in, std::uint64_t options) const {
+        auto e = read_entry(in.path);
+        if (!e || e->options != options || !e->scan.resumable || e->input.size == 0 || e->input.size > in.size)
+            return std::nullopt;
+        if (content_fingerprint(in.path, e->input.size) != e->input.content) return std::nullopt;
+        return std::move(e->scan);
+    }
+
+    // false if the entry could not be written (the run itself is unaffected).
+    bool store(const input_fingerprint& in, std::uint64_t options, const cached_scan& scan) const {
+        byte_writer w;
+        w.put_str(magic());
+        w.put(format_version);
+        w.put_str(in.path);
+        w.put(in.size);
+        w.put(in.mtime);
+        w.put(in.content);
+        w.put(options);
+        w.put(scan.counts.rows);
+        w.put(scan.counts.columns);
+        w.put(scan.records);
+        w.put<std::uint8_t>(scan.resumable);
+        w.put_str(scan.state);
+
+        std::error_code ec;
+        std::filesystem::create_directories(dir_, ec);
+        const std::filesystem::path dst = entry_path(in.path);
+        std::filesystem::path tmp = dst;
+        tmp += ".tmp";
+        {
+            std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+            if (!f || !f.write(w.bytes().data(), static_cast<std::streamsize>(w.bytes().size()))) return false;
+        }
+        std::filesystem::rename(tmp, dst, ec);
+        if (!ec) return true;
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+
+private:
+    static std::string_view magic() noexcept { return "csvqr-scan-state"; }
+
+    struct entry {
+        input_fingerprint input;
+        std::uint64_t     options = 0;
+        cached_scan       scan;
+    };
+
+    std::optional<entry> read_entry(const std::string& input) const {
+        std::ifstream f(entry_path(input), std::ios::binary);
+        if (!f) return std::nullopt;
+        const std::string bytes((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+        try {
+            byte_reader r(bytes);
+            if (r.get_str() != magic() || r.get<std::uint32_t>() != format_version) return std::nullopt;
+            entry e;
+            e.input.path    = r.get_str();
+            if (e.input.path != input) return std::nullopt;   // hash collision
+            e.input.size    = r.get<std::uint64_t>();
+            e.input.mtime   = r.get<std::int64_t>();
+            e.input.content = r.get<std::uint64_t>();
+            e.options       = r.get<std::uint64_t>();
+            e.scan.counts.rows    = r.get<std::uint64_t>();
+            e.scan.counts.columns = r.get<std::uint32_t>();
+            e.scan.records        = r.get<std::uint64_t>();
+            e.scan.resumable      = r.get<std::uint8_t>() != 0;
+            e.scan.state          = r.get_str();
+            e.scan.bytes          = e.input.size;
+            return e;
+        } catch (const std::runtime_error&) {
+            return std::nullopt;
+        }
+    }
+
+    std::filesystem::path entry_path(const std::string& input) const {
+        char name[24];
+        std::snprintf(name, sizeof name, "%016llx.state", static_cast<unsigned long long>(hash64(input)));
+        return dir_ / name;
+    }
+
+    std::filesystem::path dir_;
+};
+
+}
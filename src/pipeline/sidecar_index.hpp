@@ -0,0 +1,83 @@
+#pragma once
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include "../csv/row_index.hpp"
+#include "../util/serial.hpp"
+#include "profile_cache.hpp"
+
+namespace csvqr {
+
+// The row index of an input lives next to it as <input>.csvqr-index, so any
+// run over the same file finds it whatever its output root. The file carries
+// the fingerprint of the bytes it describes and the dialect it was counted
+// with; anything that does not match exactly is ignored (and overwritten by
+// the next run that builds one).
+inline std::filesystem::path sidecar_index_path(const std::filesystem::path& input) {
+    std::filesystem::path p = input;
+    p += ".csvqr-index";
+    return p;
+}
+
+namespace detail {
+inline std::string_view sidecar_magic() noexcept { return "csvqr-row-index"; }
+inline constexpr std::uint32_t sidecar_version = 1;
+}
+
+inline std::optional<row_index> load_sidecar_index(const std::filesystem::path& input,
+                                                   const input_fingerprint& in,
+                                                   char delimiter, char quote) {
+    std::ifstream f(sidecar_index_path(input), std::ios::binary);
+    if (!f) return std::nullopt;
+    const std::string bytes((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    try {
+        byte_reader r(bytes);
+        if (r.get_str() != detail::sidecar_magic() || r.get<std::uint32_t>() != detail::sidecar_version)
+            return std::nullopt;
+        if (r.get<std::uint64_t>() != in.size || r.get<std::int64_t>() != in.mtime ||
+            r.get<std::uint64_t>() != in.content || r.get<char>() != delimiter || r.get<char>() != quote)
+            return std::nullopt;
+        row_index ix;
+        ix.load(r);
+        if (ix.size != in.size) return std::nullopt;
+        return ix;
+    } catch (const std::runtime_error&) {
+        return std::nullopt;
+    }
+}
+
+// false if the sidecar could not be written (read-only directory); the run
+// itself is unaffected.
+inline bool store_sidecar_index(const std::filesystem::path& input, const input_fingerprint& in,
+                                char delimiter, char quote, const row_index& ix) {
+    byte_writer w;
+    w.put_str(detail::sidecar_magic());
+    w.put(detail::sidecar_version);
+    w.put(in.size);
+    w.put(in.mtime);
+    w.put(in.content);
+    w.put(delimiter);
+    w.put(quote);
+    ix.save(w);
+
+    const std::filesystem::path dst = sidecar_index_path(input);
+    std::filesystem::path tmp = dst;
+    tmp += ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        if (!f || !f.write(w.bytes().data(), static_cast<std::streamsize>(w.bytes().size()))) return false;
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, dst, ec);
+    if (!ec) return true;
+    std::filesystem::remove(tmp, ec);
+    return false;
+}
+
+}
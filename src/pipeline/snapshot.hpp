@@ -0,0 +1,758 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../csv/csv_count.hpp"
+#include "../csv/record_splitter.hpp"
+#include "../csv/record_view.hpp"
+#include "../csv/tokenizer.hpp"
+#include "../io/chunk_reader.hpp"
+#include "../metrics/span_histogram.hpp"
+#include "../profile/profile.hpp"
+#include "../types/infer.hpp"
+#include "../types/parse_date.hpp"
+#include "../types/parse_number.hpp"
+#include "../util/arena.hpp"
+#include "../util/hash.hpp"
+#include "../util/serial.hpp"
+
+namespace csvqr {
+
+// Columnar snapshot of a profiled CSV: the cells of every column, already
+// typed by the run that wrote it, in a file meant to be memory-mapped. A
+// later run given the snapshot as its input profiles it without tokenizing or
+// parsing text: fixed-width arrays feed the numeric and date statistics
+// directly, dictionary codes are aggregated before they reach the sketches,
+// and columns are profiled in parallel. Counts, type verdicts and numeric
+// statistics equal those of the CSV; top-k counts agree within their usual
+// bounds.
+//
+// Layout (host byte order, like the profile cache; every array 8-byte aligned):
+//   magic (16 bytes) | 16 reserved bytes
+//   row groups of up to group_rows rows, per column: [null bitmap] values
+//   footer: byte_writer record (columns, dictionaries, chunk directory)
+//   footer offset (u64) | magic (16 bytes)
+//
+// A column chunk is one of
+//   int64   - int columns
+//   decimal - float columns written with a fixed number of decimals: the
+//             digits as an int64, scaled by 10^decimals (exact, and cheap to
+//             print back)
+//   float64 - other float columns (shortest round-trip text)
+//   seconds - date / datetime columns, epoch seconds (int64)
+//   dict    - u8 / u16 / u32 codes into the column's dictionary
+// A typed cell is stored as a number only if its trimmed text is the
+// canonical text of that number (snapshot_text); the first cell that is not
+// (leading zeros, another date layout, mixed decimals) turns the column into
+// a dictionary from that row group on, so the reader always gets back the
+// text the writer saw. Bool and string columns are dictionaries. Null cells
+// (by the writing run's null tokens) and cells of rows before a column
+// appeared are set in the bitmap.
+
+enum class snapshot_kind : std::uint8_t { int64 = 1, float64 = 2, seconds = 3, dict = 4, decimal = 5 };
+
+struct snapshot_chunk {
+    snapshot_kind kind       = snapshot_kind::dict;
+    std::uint8_t  code_bytes = 0;   // dict: 1, 2 or 4
+    std::uint64_t nulls      = 0;   // rows set in the bitmap
+    std::uint64_t null_bits  = 0;   // file offset of the bitmap; 0 = no nulls
+    std::uint64_t values     = 0;   // file offset of the values
+};
+
+struct snapshot_column {
+    std::string   name;
+    std::uint8_t  types     = 0;   // the writing run's verdict (forced_type_bits of its logical type)
+    std::uint8_t  text_form = 0;   // decimal: decimals; seconds: date/time separator, 0 = date only
+    std::uint64_t first_row = 0;   // data rows before the column appeared (set as nulls)
+    std::vector<std::string> dict;
+};
+
+namespace detail {
+inline constexpr std::string_view snapshot_magic = "csvqr-snapshot-1";   // 16 bytes
+inline constexpr std::uint32_t    snapshot_version = 1;
+inline constexpr std::uint64_t    snapshot_group_rows = 65536;
+inline constexpr std::uint8_t     max_decimals = 18;
+
+inline constexpr double pow10_table[max_decimals + 1] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18};
+
+// The double a decimal cell parses to: both operands are exact (|digits| <=
+// 2^53, powers of ten up to 1e22 are), so the one rounding of the division
+// gives the correctly rounded value, as parse_numeric does.
+inline double decimal_value(std::int64_t digits, std::uint8_t decimals) noexcept {
+    return static_cast<double>(digits) / pow10_table[decimals];
+}
+
+// The digits of fixed-decimal text ("-12.50" -> -1250), if they fit a double exactly.
+inline std::optional<std::int64_t> decimal_digits(std::string_view t, std::uint8_t decimals) noexcept {
+    const bool neg = !t.empty() && t[0] == '-';
+    if (neg) t.remove_prefix(1);
+    if (t.size() < std::size_t{decimals} + 2 || t[t.size() - decimals - 1] != '.') return std::nullopt;
+    std::int64_t m = 0;
+    for (std::size_t i = 0; i < t.size(); ++i) {
+        if (i == t.size() - decimals - 1) continue;
+        if (!is_digit_c(t[i]) || m > (std::int64_t{1} << 53) / 10) return std::nullopt;
+        m = m * 10 + (t[i] - '0');
+    }
+    if (m > (std::int64_t{1} << 53)) return std::nullopt;
+    return neg ? -m : m;
+}
+
+// YYYY-MM-DD[<sep>HH:MM:SS] into buf; 0 if the year is outside 0..9999.
+inline std::size_t format_iso_seconds(char* buf, std::int64_t seconds, char sep) noexcept {
+    std::int64_t days = seconds / 86400, sod = seconds % 86400;
+    if (sod < 0) { sod += 86400; --days; }
+    const civil_date c = civil_from_days(days);
+    if (c.y < 0 || c.y > 9999) return 0;
+    auto two = [](char* p, int v){ p[0] = static_cast<char>('0' + v / 10); p[1] = static_cast<char>('0' + v % 10); };
+    const int y = static_cast<int>(c.y);
+    two(buf, y / 100); two(buf + 2, y % 100);
+    buf[4] = '-'; two(buf + 5, c.m); buf[7] = '-'; two(buf + 8, c.d);
+    if (sep == 0) return 10;
+    buf[10] = sep;
+    two(buf + 11, static_cast<int>(sod / 3600)); buf[13] = ':';
+    two(buf + 14, static_cast<int>(sod / 60 % 60)); buf[16] = ':';
+    two(buf + 17, static_cast<int>(sod % 60));
+    return 19;
+}
+}
+
+// Canonical text of a stored value (raw: the 8 value bytes) into buf (at
+// least 32 chars).
+inline std::string_view snapshot_text(snapshot_kind kind, std::uint8_t form, std::uint64_t raw, char* buf) noexcept {
+    constexpr std::size_t cap = 32;
+    switch (kind) {
+    case snapshot_kind::int64: {
+        std::int64_t v;
+        std::memcpy(&v, &raw, sizeof v);
+        return {buf, static_cast<std::size_t>(std::to_chars(buf, buf + cap, v).ptr - buf)};
+    }
+    case snapshot_kind::float64: {
+        double d;
+        std::memcpy(&d, &raw, sizeof d);
+        const auto r = std::to_chars(buf, buf + cap, d);
+        return {buf, r.ec == std::errc() ? static_cast<std::size_t>(r.ptr - buf) : 0};
+    }
+    case snapshot_kind::decimal: {
+        std::int64_t m;
+        std::memcpy(&m, &raw, sizeof m);
+        char* p = buf;
+        if (m < 0) *p++ = '-';
+        char digits[24];
+        const std::uint64_t u = m < 0 ? 0 - static_cast<std::uint64_t>(m) : static_cast<std::uint64_t>(m);
+        const std::size_t n = static_cast<std::size_t>(std::to_chars(digits, digits + sizeof digits, u).ptr - digits);
+        const std::size_t zeros = n <= form ? form + 1u - n : 0;   // at least one digit before the point
+        const std::size_t whole = n + zeros - form;
+        for (std::size_t i = 0; i < n + zeros; ++i) {
+            if (i == whole) *p++ = '.';
+            *p++ = i < zeros ? '0' : digits[i - zeros];
+        }
+        return {buf, static_cast<std::size_t>(p - buf)};
+    }
+    case snapshot_kind::seconds: {
+        std::int64_t v;
+        std::memcpy(&v, &raw, sizeof v);
+        return {buf, detail::format_iso_seconds(buf, v, static_cast<char>(form))};
+    }
+    default:
+        return {};
+    }
+}
+
+inline bool is_snapshot_bytes(std::string_view head) noexcept {
+    return head.substr(0, detail::snapshot_magic.size()) == detail::snapshot_magic;
+}
+
+// Regular files only: the check reads the first bytes of the input.
+inline bool is_snapshot_file(const std::filesystem::path& path) {
+    std::error_code ec;
+    if (!std::filesystem::is_regular_file(path, ec)) return false;
+    std::ifstream f(path, std::ios::binary);
+    char head[16] = {};
+    return f.read(head, sizeof head) && is_snapshot_bytes(std::string_view(head, sizeof head));
+}
+
+// ---------- writing ----------
+// Takes the data records of the profiled CSV (tokenized, header excluded)
+// and streams row groups to `out`; the column layout and types come from the
+// finished profile of the same bytes.
+class snapshot_writer {
+public:
+    snapshot_writer(std::ofstream& out, const ProfileResult& profile, const profile_options& popt,
+                    std::size_t initial_width)
+        : out_(out), nulls_(popt.null_tokens), dates_(popt.date_formats, popt.datetime_formats),
+          date_formats_(popt.date_formats), datetime_formats_(popt.datetime_formats),
+          width_(initial_width)
+    {
+        cols_.resize(profile.columns.size());
+        for (std::size_t c = 0; c < cols_.size(); ++c) {
+            const ColumnSummary& cs = profile.columns[c];
+            column_out& col = cols_[c];
+            col.meta.name  = cs.name;
+            col.meta.types = forced_type_bits(cs.logical_type).value_or(0);
+            col.with_time  = cs.logical_type == "datetime";
+            col.kind = cs.logical_type == "int"   ? snapshot_kind::int64
+                     : cs.logical_type == "float" ? snapshot_kind::float64
+                     : (cs.logical_type == "date" || cs.logical_type == "datetime") ? snapshot_kind::seconds
+                     : snapshot_kind::dict;
+            col.group_kind = col.kind;
+        }
+        write(detail::snapshot_magic.data(), detail::snapshot_magic.size());
+        pad(32);
+    }
+
+    void add(const record_view& rec) {
+        width_ = std::max(width_, rec.size());
+        for (std::size_t c = 0; c < cols_.size(); ++c) {
+            column_out& col = cols_[c];
+            if (c >= width_) { ++col.meta.first_row; set_null(col); continue; }
+            const std::string_view t = trim_view(c < rec.size() ? rec[c] : std::string_view{});
+            if (nulls_(t)) { set_null(col); continue; }
+            add_cell(col, t);
+        }
+        if (++n_ == detail::snapshot_group_rows) flush();
+        ++rows_;
+    }
+
+    // Writes the last group, the footer and the trailer.
+    bool finish(const CsvCounts& counts, bool has_header) {
+        flush();
+        const std::uint64_t footer = pos_;
+        byte_writer w;
+        auto strings = [&](const std::vector<std::string>& v){
+            w.put<std::uint64_t>(v.size());
+            for (const auto& x : v) w.put_str(x);
+        };
+        w.put(detail::snapshot_version);
+        w.put(rows_);
+        w.put(counts.columns);
+        w.put<std::uint8_t>(has_header);
+        w.put(detail::snapshot_group_rows);
+        strings(date_formats_);
+        strings(datetime_formats_);
+        w.put<std::uint64_t>(cols_.size());
+        for (const column_out& col : cols_) {
+            w.put_str(col.meta.name);
+            w.put(col.meta.types);
+            w.put(col.meta.text_form);
+            w.put(col.meta.first_row);
+            w.put<std::uint64_t>(col.dict.size());
+            for (const auto& s : col.dict) w.put_str(s);
+        }
+        w.put<std::uint64_t>(group_rows_.size());
+        for (std::size_t g = 0; g < group_rows_.size(); ++g) {
+            w.put(group_rows_[g]);
+            for (const column_out& col : cols_) {
+                const snapshot_chunk& ch = col.chunks[g];
+                w.put(ch.kind);
+                w.put(ch.code_bytes);
+                w.put(ch.nulls);
+                w.put(ch.null_bits);
+                w.put(ch.values);
+            }
+        }
+        write(w.bytes().data(), w.bytes().size());
+        write(reinterpret_cast<const char*>(&footer), sizeof footer);
+        write(detail::snapshot_magic.data(), detail::snapshot_magic.size());
+        out_.flush();
+        return static_cast<bool>(out_);
+    }
+
+    std::uint64_t rows() const noexcept { return rows_; }
+
+private:
+    struct column_out {
+        snapshot_column meta;
+        snapshot_kind   kind;           // encoding of the next groups
+        snapshot_kind   group_kind;     // encoding of the current group
+        bool            with_time = false;
+        bool            form_set  = false;
+        std::size_t     date_hint = 0;
+        std::vector<std::uint64_t> vals;    // typed group: raw value bytes
+        std::vector<std::uint32_t> codes;   // dict group
+        std::vector<std::uint64_t> null_bits;
+        std::uint64_t   nulls = 0;
+        std::deque<std::string> dict;       // stable storage for the lookup keys
+        std::unordered_map<std::string_view, std::uint32_t> ids;
+        std::vector<snapshot_chunk> chunks;
+    };
+
+    void set_null(column_out& col) {
+        if (col.null_bits.size() <= n_ / 64) col.null_bits.resize(n_ / 64 + 1, 0);
+        col.null_bits[n_ / 64] |= std::uint64_t{1} << (n_ % 64);
+        ++col.nulls;
+        if (col.group_kind == snapshot_kind::dict) col.codes.push_back(0);
+        else col.vals.push_back(0);
+    }
+
+    static bool is_null_row(const column_out& col, std::uint64_t i) noexcept {
+        return i / 64 < col.null_bits.size() && (col.null_bits[i / 64] >> (i % 64) & 1) != 0;
+    }
+
+    std::uint32_t intern(column_out& col, std::string_view t) {
+        const auto it = col.ids.find(t);
+        if (it != col.ids.end()) return it->second;
+        const auto id = static_cast<std::uint32_t>(col.dict.size());
+        col.dict.emplace_back(t);
+        col.ids.emplace(col.dict.back(), id);
+        return id;
+    }
+
+    void add_cell(column_out& col, std::string_view t) {
+        if (col.group_kind != snapshot_kind::dict) {
+            if (const auto raw = typed_value(col, t)) { col.vals.push_back(*raw); return; }
+            demote(col);
+        }
+        col.codes.push_back(intern(col, t));
+    }
+
+    // The value of t if t is its canonical text under the column's form
+    // (fixed by the first typed cell).
+    std::optional<std::uint64_t> typed_value(column_out& col, std::string_view t) {
+        std::uint64_t raw = 0;
+        if (col.group_kind == snapshot_kind::float64 && !col.form_set) {
+            // writers usually print a fixed number of decimals ("12.50")
+            const std::size_t dot = t.find('.');
+            if (dot != std::string_view::npos && t.find_first_of("eE") == std::string_view::npos &&
+                t.size() - dot - 1 <= detail::max_decimals) {
+                col.kind = col.group_kind = snapshot_kind::decimal;
+                col.meta.text_form = static_cast<std::uint8_t>(t.size() - dot - 1);
+            }
+            col.form_set = true;
+        }
+        switch (col.group_kind) {
+        case snapshot_kind::int64: {
+            const numeric_value x = parse_numeric(t);
+            if (!x.is_int()) return std::nullopt;
+            std::memcpy(&raw, &x.i, sizeof raw);
+            break;
+        }
+        case snapshot_kind::float64: {
+            const numeric_value x = parse_numeric(t);
+            if (!x) return std::nullopt;
+            std::memcpy(&raw, &x.d, sizeof raw);
+            break;
+        }
+        case snapshot_kind::decimal: {
+            const auto m = detail::decimal_digits(t, col.meta.text_form);
+            if (!m) return std::nullopt;
+            std::memcpy(&raw, &*m, sizeof raw);
+            break;
+        }
+        case snapshot_kind::seconds: {
+            const auto d = dates_.parse(t, col.date_hint);
+            if (!d) return std::nullopt;
+            std::memcpy(&raw, &d->seconds, sizeof raw);
+            if (!col.form_set) {
+                col.meta.text_form = col.with_time ? (t.size() > 10 ? t[10] : 'T') : 0;
+                col.form_set = true;
+            }
+            break;
+        }
+        default:
+            return std::nullopt;
+        }
+        if (snapshot_text(col.group_kind, col.meta.text_form, raw, buf_) != t) return std::nullopt;
+        return raw;
+    }
+
+    // Rewrites the current group's typed values as dictionary codes; the
+    // column stays a dictionary from here on.
+    void demote(column_out& col) {
+        col.codes.resize(col.vals.size());
+        for (std::size_t i = 0; i < col.vals.size(); ++i)
+            col.codes[i] = is_null_row(col, i) ? 0
+                         : intern(col, snapshot_text(col.group_kind, col.meta.text_form, col.vals[i], buf_));
+        col.vals.clear();
+        col.kind = col.group_kind = snapshot_kind::dict;
+    }
+
+    void flush() {
+        if (n_ == 0) return;
+        for (column_out& col : cols_) {
+            snapshot_chunk ch;
+            ch.kind  = col.group_kind;
+            ch.nulls = col.nulls;
+            if (col.nulls > 0) {
+                col.null_bits.resize((n_ + 63) / 64, 0);
+                ch.null_bits = pos_;
+                write(reinterpret_cast<const char*>(col.null_bits.data()), col.null_bits.size() * 8);
+                pad(8);
+            }
+            ch.values = pos_;
+            if (ch.kind == snapshot_kind::dict) {
+                const std::uint32_t top = col.codes.empty() ? 0 : *std::max_element(col.codes.begin(), col.codes.end());
+                ch.code_bytes = top < 0x100 ? 1 : top < 0x10000 ? 2 : 4;
+                write_codes(col.codes, ch.code_bytes);
+            } else {
+                write(reinterpret_cast<const char*>(col.vals.data()), col.vals.size() * 8);
+            }
+            pad(8);
+            col.chunks.push_back(ch);
+            col.vals.clear();
+            col.codes.clear();
+            col.null_bits.clear();
+            col.nulls = 0;
+            col.group_kind = col.kind;
+        }
+        group_rows_.push_back(n_);
+        n_ = 0;
+    }
+
+    void write_codes(const std::vector<std::uint32_t>& codes, std::uint8_t bytes) {
+        std::string buf(codes.size() * bytes, '\0');
+        for (std::size_t i = 0; i < codes.size(); ++i) {
+            if (bytes == 1) buf[i] = static_cast<char>(codes[i]);
+            else if (bytes == 2) { const auto v = static_cast<std::uint16_t>(codes[i]); std::memcpy(&buf[i * 2], &v, 2); }
+            else std::memcpy(&buf[i * 4], &codes[i], 4);
+        }
+        write(buf.data(), buf.size());
+    }
+
+    void write(const char* p, std::size_t n) {
+        out_.write(p, static_cast<std::streamsize>(n));
+        pos_ += n;
+    }
+    void pad(std::uint64_t align) {
+        static const char zeros[32] = {};
+        write(zeros, static_cast<std::size_t>((align - pos_ % align) % align));
+    }
+
+    std::ofstream&           out_;
+    null_matcher             nulls_;
+    date_parser              dates_;
+    std::vector<std::string> date_formats_, datetime_formats_;
+    std::size_t              width_;
+    std::vector<column_out>  cols_;
+    std::vector<std::uint64_t> group_rows_;
+    std::uint64_t            n_    = 0;   // rows in the current group
+    std::uint64_t            rows_ = 0;
+    std::uint64_t            pos_  = 0;
+    char                     buf_[32];
+};
+
+// Second pass over a CSV that was just profiled exactly (no projection, no
+// forced types: the snapshot must hold every column with its inferred type),
+// written to a temporary file and renamed into place. false if the input
+// cannot be read again, no longer has the profiled row count, or the
+// snapshot cannot be written.
+inline bool write_snapshot(const std::filesystem::path& input, const std::filesystem::path& out,
+                           char delimiter, char quote, bool has_header, const profile_options& popt,
+                           const ProfileResult& profile, const CsvCounts& counts) {
+    std::filesystem::path tmp = out;
+    tmp += ".tmp";
+    bool ok = false;
+    try {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        if (!f) return false;
+        chunk_reader reader(input, 1u << 20);
+        record_splitter split(quote);
+        record_tokenizer tok(delimiter, quote);
+        record_view rec;
+        arena scratch;
+        std::optional<snapshot_writer> w;
+        auto on_record = [&](std::string_view line){
+            tok.tokenize(line, rec, scratch);
+            if (!w) {
+                w.emplace(f, profile, popt, rec.size());
+                if (has_header) return;
+            }
+            w->add(rec);
+        };
+        for (std::string_view chunk = reader.next(); !chunk.empty(); chunk = reader.next()) {
+            split.feed(chunk, on_record);
+            scratch.reset();
+        }
+        split.finish(on_record);
+        if (!w) w.emplace(f, profile, popt, 0);
+        ok = w->rows() == profile.rows && w->finish(counts, has_header);
+    } catch (const std::exception&) {
+        ok = false;
+    }
+    std::error_code ec;
+    if (ok) {
+        std::filesystem::rename(tmp, out, ec);
+        if (!ec) return true;
+    }
+    std::filesystem::remove(tmp, ec);
+    return false;
+}
+
+// ---------- reading ----------
+// A snapshot mapped in memory; the constructor checks the framing and that
+// every chunk lies inside the data section, and throws std::runtime_error
+// for anything else. `data` must outlive the object.
+class snapshot_file {
+public:
+    explicit snapshot_file(std::string_view data) : data_(data) {
+        const std::size_t tail = 8 + detail::snapshot_magic.size();
+        if (data.size() < 32 + tail || !is_snapshot_bytes(data) ||
+            data.substr(data.size() - detail::snapshot_magic.size()) != detail::snapshot_magic)
+            throw std::runtime_error("not a csvqr snapshot");
+        std::uint64_t footer = 0;
+        std::memcpy(&footer, data.data() + data.size() - tail, sizeof footer);
+        if (footer < 32 || footer > data.size() - tail) throw std::runtime_error("snapshot footer is out of range");
+
+        byte_reader r(data.substr(static_cast<std::size_t>(footer), data.size() - tail - static_cast<std::size_t>(footer)));
+        auto strings = [&]{
+            std::vector<std::string> v(checked_count(r.get<std::uint64_t>(), footer));
+            for (auto& x : v) x = r.get_str();
+            return v;
+        };
+        if (r.get<std::uint32_t>() != detail::snapshot_version) throw std::runtime_error("unsupported snapshot version");
+        rows_       = r.get<std::uint64_t>();
+        width_      = r.get<std::uint32_t>();
+        has_header_ = r.get<std::uint8_t>() != 0;
+        r.get<std::uint64_t>();   // group_rows
+        date_formats_     = strings();
+        datetime_formats_ = strings();
+        cols_.resize(checked_count(r.get<std::uint64_t>(), footer));
+        for (snapshot_column& col : cols_) {
+            col.name      = r.get_str();
+            col.types     = r.get<std::uint8_t>();
+            col.text_form = r.get<std::uint8_t>();
+            col.first_row = r.get<std::uint64_t>();
+            col.dict.resize(checked_count(r.get<std::uint64_t>(), footer));
+            for (auto& s : col.dict) s = r.get_str();
+        }
+        group_rows_.resize(checked_count(r.get<std::uint64_t>(), footer));
+        chunks_.resize(group_rows_.size() * cols_.size());
+        std::uint64_t total = 0;
+        for (std::size_t g = 0; g < group_rows_.size(); ++g) {
+            const std::uint64_t n = group_rows_[g] = r.get<std::uint64_t>();
+            total += n;
+            for (std::size_t c = 0; c < cols_.size(); ++c) {
+                snapshot_chunk& ch = chunks_[g * cols_.size() + c];
+                ch.kind       = r.get<snapshot_kind>();
+                ch.code_bytes = r.get<std::uint8_t>();
+                ch.nulls      = r.get<std::uint64_t>();
+                ch.null_bits  = r.get<std::uint64_t>();
+                ch.values     = r.get<std::uint64_t>();
+                const std::uint64_t width = ch.kind == snapshot_kind::dict ? ch.code_bytes : 8;
+                const bool codes_ok = ch.kind != snapshot_kind::dict ||
+                                      ch.code_bytes == 1 || ch.code_bytes == 2 || ch.code_bytes == 4;
+                const bool form_ok = ch.kind != snapshot_kind::decimal || cols_[c].text_form <= detail::max_decimals;
+                if (ch.kind < snapshot_kind::int64 || ch.kind > snapshot_kind::decimal || !codes_ok || !form_ok ||
+                    ch.nulls > n || (ch.nulls > 0 && !in_data(ch.null_bits, (n + 63) / 64 * 8, footer)) ||
+                    !in_data(ch.values, n * width, footer))
+                    throw std::runtime_error("snapshot chunk is out of range");
+                if (ch.kind == snapshot_kind::dict)
+                    for (std::uint64_t i = 0; i < n; ++i)
+                        if (!is_null(ch, i) && code(ch, i) >= cols_[c].dict.size())
+                            throw std::runtime_error("snapshot code is out of range");
+            }
+        }
+        if (total != rows_) throw std::runtime_error("snapshot row count does not match its groups");
+    }
+
+    std::uint64_t rows()       const noexcept { return rows_; }
+    bool          has_header() const noexcept { return has_header_; }
+    // The CSV's counts (columns: width of its first record, as csv_counter has it).
+    CsvCounts     counts()     const noexcept { return CsvCounts{rows_, width_}; }
+    std::size_t   columns()    const noexcept { return cols_.size(); }
+    std::size_t   groups()     const noexcept { return group_rows_.size(); }
+    std::uint64_t group_rows(std::size_t g) const noexcept { return group_rows_[g]; }
+    const snapshot_column& column(std::size_t c) const noexcept { return cols_[c]; }
+    const snapshot_chunk&  chunk(std::size_t g, std::size_t c) const noexcept { return chunks_[g * cols_.size() + c]; }
+    const std::vector<std::string>& date_formats()     const noexcept { return date_formats_; }
+    const std::vector<std::string>& datetime_formats() const noexcept { return datetime_formats_; }
+
+    bool is_null(const snapshot_chunk& ch, std::uint64_t i) const noexcept {
+        if (ch.nulls == 0) return false;
+        std::uint64_t word;
+        std::memcpy(&word, data_.data() + ch.null_bits + i / 64 * 8, sizeof word);
+        return (word >> (i % 64) & 1) != 0;
+    }
+    std::uint64_t raw(const snapshot_chunk& ch, std::uint64_t i) const noexcept {
+        std::uint64_t v;
+        std::memcpy(&v, data_.data() + ch.values + i * 8, sizeof v);
+        return v;
+    }
+    std::uint32_t code(const snapshot_chunk& ch, std::uint64_t i) const noexcept {
+        const char* p = data_.data() + ch.values + i * ch.code_bytes;
+        if (ch.code_bytes == 1) return static_cast<unsigned char>(*p);
+        if (ch.code_bytes == 2) { std::uint16_t v; std::memcpy(&v, p, 2); return v; }
+        std::uint32_t v;
+        std::memcpy(&v, p, 4);
+        return v;
+    }
+
+private:
+    static std::size_t checked_count(std::uint64_t n, std::uint64_t bound) {
+        if (n > bound) throw std::runtime_error("serialized state is truncated");
+        return static_cast<std::size_t>(n);
+    }
+    static bool in_data(std::uint64_t off, std::uint64_t len, std::uint64_t end) noexcept {
+        return off >= 32 && off % 8 == 0 && off <= end && len <= end - off;
+    }
+
+    std::string_view data_;
+    std::uint64_t rows_  = 0;
+    std::uint32_t width_ = 0;
+    bool          has_header_ = false;
+    std::vector<std::string> date_formats_, datetime_formats_;
+    std::vector<snapshot_column> cols_;
+    std::vector<std::uint64_t>   group_rows_;
+    std::vector<snapshot_chunk>  chunks_;
+};
+
+namespace detail {
+
+// Fast path: the column keeps the writer's verdict, so values feed the
+// accumulators directly. Dictionary entries are hashed and parsed once and
+// reach the distinct and top-k sketches once each, with their row count.
+inline void profile_snapshot_typed(const snapshot_file& snap, std::size_t c, column_state& st,
+                                   const date_parser& dates) {
+    const snapshot_column& col = snap.column(c);
+    st.types = col.types;
+    const bool numeric = st.can(type_bits::float64), temporal = st.can(type_bits::datetime);
+    const bool with_time = col.text_form != 0;
+
+    std::vector<std::uint64_t> hits(col.dict.size(), 0);
+    std::vector<numeric_value> nums(numeric ? col.dict.size() : 0);
+    std::vector<std::optional<date_value>> dts(temporal ? col.dict.size() : 0);
+    std::size_t hint = 0;
+    for (std::size_t k = 0; k < nums.size(); ++k) nums[k] = parse_numeric(col.dict[k]);
+    for (std::size_t k = 0; k < dts.size(); ++k) dts[k] = dates.parse(col.dict[k], hint);
+
+    char buf[32];
+    for (std::size_t g = 0; g < snap.groups(); ++g) {
+        const snapshot_chunk& ch = snap.chunk(g, c);
+        const std::uint64_t n = snap.group_rows(g);
+        st.nulls     += ch.nulls;
+        st.non_nulls += n - ch.nulls;
+        for (std::uint64_t i = 0; i < n; ++i) {
+            if (snap.is_null(ch, i)) continue;
+            if (ch.kind == snapshot_kind::dict) {
+                const std::uint32_t k = snap.code(ch, i);
+                ++hits[k];
+                if (numeric)  feed_number(st, nums[k]);
+                if (temporal) feed_date(st, dts[k]);
+                continue;
+            }
+            const std::uint64_t raw = snap.raw(ch, i);
+            const std::string_view t = snapshot_text(ch.kind, col.text_form, raw, buf);
+            const std::uint64_t h = hash64(t);
+            st.distinct.add_hash(h);
+            if (st.track_topk) st.cat.add(t, h);
+            numeric_value x;
+            switch (ch.kind) {
+            case snapshot_kind::int64:
+                x.kind = numeric_value::int64;
+                std::memcpy(&x.i, &raw, sizeof x.i);
+                x.d = static_cast<double>(x.i);
+                feed_number(st, x);
+                break;
+            case snapshot_kind::float64:
+                x.kind = numeric_value::float64;
+                std::memcpy(&x.d, &raw, sizeof x.d);
+                feed_number(st, x);
+                break;
+            case snapshot_kind::decimal: {
+                std::int64_t m;
+                std::memcpy(&m, &raw, sizeof m);
+                x.kind = numeric_value::float64;
+                x.d = detail::decimal_value(m, col.text_form);
+                feed_number(st, x);
+                break;
+            }
+            default: {
+                date_value d;   // feed_date only reads seconds and has_time
+                std::memcpy(&d.seconds, &raw, sizeof d.seconds);
+                d.has_time = with_time;
+                feed_date(st, d);
+            }
+            }
+        }
+    }
+    for (std::size_t k = 0; k < hits.size(); ++k) {
+        if (hits[k] == 0) continue;
+        const std::uint64_t h = hash64(col.dict[k]);
+        st.distinct.add_hash(h);
+        if (st.track_topk) st.cat.add(col.dict[k], h, hits[k]);
+    }
+}
+
+// Columns forced by the reading run: cells go back to text and through the
+// batch kernel, as a CSV column would.
+inline void profile_snapshot_text(const snapshot_file& snap, std::size_t c, column_state& st,
+                                  const column_profiler& prof) {
+    const snapshot_column& col = snap.column(c);
+    std::vector<std::string_view> cells, scratch;
+    std::vector<std::pair<std::size_t, std::size_t>> spans;   // typed cells: offset, length in text
+    std::string text;
+    char buf[32];
+    for (std::size_t g = 0; g < snap.groups(); ++g) {
+        const snapshot_chunk& ch = snap.chunk(g, c);
+        const std::uint64_t n = snap.group_rows(g);
+        st.nulls += ch.nulls;
+        cells.clear();
+        spans.clear();
+        text.clear();
+        for (std::uint64_t i = 0; i < n; ++i) {
+            if (snap.is_null(ch, i)) continue;
+            if (ch.kind == snapshot_kind::dict) { cells.push_back(col.dict[snap.code(ch, i)]); continue; }
+            const std::string_view t = snapshot_text(ch.kind, col.text_form, snap.raw(ch, i), buf);
+            spans.emplace_back(text.size(), t.size());
+            text.append(t);
+        }
+        for (const auto& [off, len] : spans) cells.emplace_back(text.data() + off, len);
+        prof.profile_cells(st, cells.data(), cells.size(), scratch);
+    }
+}
+
+}
+
+// Profiles a snapshot into a fresh profiler: the layout comes from the stored
+// names (the profiler's [columns] projection and [types] force apply), then
+// each selected column is profiled on its own, `threads` at a time (0 = all
+// cores). Null tokens and date formats are the writing run's. With
+// column_spans, the time of each column is added to it.
+inline void profile_snapshot(const snapshot_file& snap, column_profiler& prof, int threads = 1,
+                             span_histogram* column_spans = nullptr) {
+    std::vector<std::string> names(snap.columns());
+    for (std::size_t c = 0; c < names.size(); ++c) names[c] = snap.column(c).name;
+    prof.preset_columns(names, snap.rows());
+    const date_parser dates(snap.date_formats(), snap.datetime_formats());
+
+    std::size_t n = threads > 0 ? static_cast<std::size_t>(threads)
+                                : std::max(1u, std::thread::hardware_concurrency());
+    n = std::max<std::size_t>(1, std::min(n, snap.columns()));
+    std::vector<span_histogram> spans(column_spans ? n : 0);   // per worker, merged after the join
+    std::atomic<std::size_t> next{0};
+    auto work = [&](std::size_t w){
+        for (std::size_t c = next++; c < snap.columns(); c = next++) {
+            column_state* st = prof.source_column(c);
+            if (!st) continue;
+            WallTimer t;
+            t.start();
+            if (st->forced) detail::profile_snapshot_text(snap, c, *st, prof);
+            else detail::profile_snapshot_typed(snap, c, *st, dates);
+            st->nulls    -= snap.column(c).first_row;   // rows before the column appeared
+            st->first_row = snap.column(c).first_row;
+            t.stop();
+            if (column_spans) spans[w].add(t);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (std::size_t i = 1; i < n; ++i) pool.emplace_back(work, i);
+    work(0);
+    for (auto& t : pool) t.join();
+    for (const span_histogram& h : spans) column_spans->merge(h);
+}
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include "../csv/record_view.hpp"
+
+namespace csvqr {
+
+// Column-major staging area for up to `capacity` tokenized rows: cells[c][r]
+// is field c of row r (a view into the chunk or the profiler's arena).
+// Rows narrower than the batch are padded with empty fields (= null), so every
+// column holds exactly rows() cells and the per-column kernels can run over
+// one contiguous array at a time.
+class column_batch {
+public:
+    explicit column_batch(std::size_t capacity = 4096) : capacity_(capacity ? capacity : 1) {}
+
+    void set_width(std::size_t ncols) {
+        if (ncols <= cols_.size()) return;
+        const std::size_t old = cols_.size();
+        cols_.resize(ncols);
+        for (std::size_t c = old; c < ncols; ++c) {
+            cols_[c].reserve(capacity_);
+            cols_[c].assign(rows_, std::string_view{});
+        }
+    }
+
+    // Fields beyond width() are dropped; widen with set_width() first.
+    void append(const record_view& rec) {
+        const std::size_t n = rec.size() < cols_.size() ? rec.size() : cols_.size();
+        for (std::size_t c = 0; c < n; ++c) cols_[c].push_back(rec[c]);
+        for (std::size_t c = n; c < cols_.size(); ++c) cols_[c].emplace_back();
+        ++rows_;
+    }
+
+    void clear() noexcept {
+        for (auto& col : cols_) col.clear();
+        rows_ = 0;
+    }
+
+    std::size_t width()    const noexcept { return cols_.size(); }
+    std::size_t rows()     const noexcept { return rows_; }
+    std::size_t capacity() const noexcept { return capacity_; }
+    bool        full()     const noexcept { return rows_ >= capacity_; }
+    bool        empty()    const noexcept { return rows_ == 0; }
+
+    const std::string_view* column(std::size_t c) const noexcept { return cols_[c].data(); }
+
+private:
+    std::size_t capacity_;
+    std::size_t rows_ = 0;
+    std::vector<std::vector<std::string_view>> cols_;
+};
+
+}
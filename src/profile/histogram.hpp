@@ -1,18 +1,31 @@
 #pragma once
 #include <vector>
 #include <limits>
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <algorithm>
 #include <stdexcept>
 
+#include "../util/serial.hpp"
+
 namespace csvqr {
 
 struct histogram {
     int bins{0};
     std::vector<double> edges;   // size = bins+1
     std::vector<std::size_t> counts; // size = bins
+
+    // Adds another histogram over the same edges (e.g. one per thread).
+    void merge(const histogram& o) {
+        if (o.bins != bins || o.edges != edges)
+            throw std::invalid_argument("histogram::merge: bin edges differ");
+        for (std::size_t i = 0; i < counts.size(); ++i) counts[i] += o.counts[i];
+    }
 };
 
+// Equal-width bins over materialized values (two passes); the profiler uses
+// stream_histogram below instead.
 inline histogram make_histogram(const std::vector<double>& values, int bins) {
     if (bins <= 0) throw std::invalid_argument("bins must be > 0");
     histogram h;
@@ -42,4 +55,159 @@ inline histogram make_histogram(const std::vector<double>& values, int bins) {
     return h;
 }
 
-} 
+// One-pass, fixed-memory histogram of at most `max_bins` bins.
+// Bins have width 2^e and sit on the global grid floor(x / 2^e); e is always
+// the smallest exponent for which [min, max] spans at most max_bins grid
+// cells. When the range grows past that, e goes up and adjacent cells merge
+// pairwise (coarsening floor(x/2^e) is exact), so the state depends only on
+// the multiset of values seen: any split of the input merged back together
+// gives exactly the histogram of a single pass. Non-finite values are skipped.
+class stream_histogram {
+public:
+    explicit stream_histogram(int max_bins = 32) : max_bins_(max_bins < 2 ? 2 : max_bins) {}
+
+    void add(double x) {
+        if (!std::isfinite(x)) return;
+        if (n_ == 0) { min_ = max_ = x; n_ = 1; return; }
+        if (!counts_.empty()) {
+            // inside the current window: the grid stays minimal, just count
+            const double k = std::floor(x * scale_) - k0_;
+            if (k >= 0.0 && k < static_cast<double>(max_bins_)) {
+                min_ = std::min(min_, x);
+                max_ = std::max(max_, x);
+                ++n_;
+                ++counts_[static_cast<std::size_t>(k)];
+                return;
+            }
+        }
+        if (x < min_ || x > max_) {
+            const double mn = std::min(min_, x), mx = std::max(max_, x);
+            regrid(mn, mx);
+        }
+        ++n_;
+        if (counts_.empty()) return;   // every value so far equals min_
+        ++counts_[cell(x)];
+    }
+
+    void merge(const stream_histogram& o) {
+        if (o.n_ == 0) return;
+        if (n_ == 0) { *this = o; return; }
+        if (o.max_bins_ != max_bins_) throw std::invalid_argument("stream_histogram::merge: bin counts differ");
+        regrid(std::min(min_, o.min_), std::max(max_, o.max_));
+        if (counts_.empty()) { n_ += o.n_; return; }   // both single-valued, same value
+        if (o.counts_.empty()) counts_[cell(o.min_)] += o.n_;
+        else
+            for (std::size_t i = 0; i < o.counts_.size(); ++i)
+                if (o.counts_[i]) counts_[cell(o.center(i))] += o.counts_[i];
+        n_ += o.n_;
+    }
+
+    std::uint64_t count() const noexcept { return n_; }
+
+    // Bins from the cell holding min to the cell holding max; a single
+    // repeated value gives one zero-width bin. Bins narrower than
+    // 2^min_exponent are merged on output (0 for integer columns).
+    histogram to_histogram(int min_exponent = std::numeric_limits<int>::min()) const {
+        histogram h;
+        if (n_ == 0) return h;
+        if (counts_.empty()) {
+            h.bins = 1;
+            h.edges = {min_, max_};
+            h.counts = {static_cast<std::size_t>(n_)};
+            return h;
+        }
+        const int e = std::max(e_, min_exponent);
+        const int shift = e - e_;
+        const double k0 = std::floor(std::ldexp(k0_, -shift));
+        const auto out_cell = [&](std::size_t i) {
+            return static_cast<std::size_t>(std::floor(std::ldexp(k0_ + static_cast<double>(i), -shift)) - k0);
+        };
+        const std::size_t last = out_cell(cell(max_));
+        h.bins = static_cast<int>(last + 1);
+        for (std::size_t i = 0; i <= last + 1; ++i) h.edges.push_back(std::ldexp(k0 + static_cast<double>(i), e));
+        h.counts.assign(last + 1, 0);
+        for (std::size_t i = 0; i < counts_.size(); ++i)
+            if (counts_[i]) h.counts[out_cell(i)] += static_cast<std::size_t>(counts_[i]);
+        return h;
+    }
+
+    void save(byte_writer& w) const {
+        w.put(max_bins_);
+        w.put(n_);
+        w.put(min_);
+        w.put(max_);
+        w.put(e_);
+        w.put(k0_);
+        w.put_vec(counts_);
+    }
+    void load(byte_reader& r) {
+        max_bins_ = r.get<int>();
+        n_   = r.get<std::uint64_t>();
+        min_ = r.get<double>();
+        max_ = r.get<double>();
+        e_   = r.get<int>();
+        k0_  = r.get<double>();
+        counts_ = r.get_vec<std::uint64_t>();
+        if (max_bins_ < 2 || (!counts_.empty() && counts_.size() != static_cast<std::size_t>(max_bins_)))
+            throw std::runtime_error("stream_histogram: bad saved state");
+        scale_ = std::ldexp(1.0, -e_);
+    }
+
+private:
+    // Grid cell of x relative to the window start. Scaling by a power of two
+    // is exact, so the floor is the true grid index.
+    std::size_t cell(double x) const noexcept {
+        return static_cast<std::size_t>(std::floor(x * scale_) - k0_);
+    }
+    double center(std::size_t i) const noexcept { return std::ldexp(k0_ + static_cast<double>(i) + 0.5, e_); }
+
+    bool fits(double mn, double mx, int e) const noexcept {
+        return std::floor(std::ldexp(mx, -e)) - std::floor(std::ldexp(mn, -e)) < static_cast<double>(max_bins_);
+    }
+
+    // Moves to the grid of the new range [mn, mx] (mn < mx), re-binning what
+    // was counted so far; a no-op if the current grid still covers it.
+    void regrid(double mn, double mx) {
+        if (mn == mx) return;
+        int e;
+        if (counts_.empty()) {
+            int ex = 0;
+            std::frexp((mx - mn) / max_bins_, &ex);   // 2^(ex-1) <= width < 2^ex
+            e = ex - 2;
+        } else {
+            e = e_;
+        }
+        while (!fits(mn, mx, e)) ++e;
+
+        const double new_k0 = std::floor(std::ldexp(mn, -e));
+        if (!counts_.empty() && e == e_ && new_k0 == k0_) { min_ = mn; max_ = mx; return; }   // same window
+        std::vector<std::uint64_t> fresh(static_cast<std::size_t>(max_bins_), 0);
+        if (counts_.empty()) {
+            // all previous values were min_ == max_
+            fresh[static_cast<std::size_t>(std::floor(std::ldexp(min_, -e)) - new_k0)] += n_;
+        } else {
+            const int shift = e - e_;
+            for (std::size_t i = 0; i < counts_.size(); ++i) {
+                if (!counts_[i]) continue;
+                const double coarse = std::floor(std::ldexp(k0_ + static_cast<double>(i), -shift));
+                fresh[static_cast<std::size_t>(coarse - new_k0)] += counts_[i];
+            }
+        }
+        counts_.swap(fresh);
+        e_ = e;
+        k0_ = new_k0;
+        scale_ = std::ldexp(1.0, -e);
+        min_ = mn;
+        max_ = mx;
+    }
+
+    int                        max_bins_;
+    std::uint64_t              n_     = 0;
+    double                     min_   = 0.0, max_ = 0.0;
+    int                        e_     = 0;     // bin width 2^e
+    double                     k0_    = 0.0;   // grid index of counts_[0]
+    double                     scale_ = 1.0;   // 2^-e
+    std::vector<std::uint64_t> counts_;        // empty while min_ == max_
+};
+
+}
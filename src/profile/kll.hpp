@@ -0,0 +1,174 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <stdexcept>
+#include <vector>
+
+#include "../util/serial.hpp"
+
+namespace csvqr {
+
+// KLL quantile sketch (Karnin, Lang, Liberty 2016) over doubles.
+// Items live in levels; an item at level h stands for 2^h inputs. When the
+// sketch outgrows its budget, the lowest full level is sorted and every other
+// item (random offset) is promoted, halving that level.
+//  - memory: about 3k doubles however many values are added
+//  - rank error: ~1.7/k of n at 99% confidence (k=200 -> ~0.85%, measured
+//    below 1.5% in tests); min and max are exact
+//  - merge() is associative, so per-thread / per-file sketches can be combined
+// The coin flips come from a fixed-seed generator, so a given input order
+// always produces the same sketch.
+class kll_sketch {
+public:
+    explicit kll_sketch(std::uint16_t k = 200) : k_(k < 8 ? 8 : k) { add_level(); }
+
+    void add(double x) {
+        if (std::isnan(x)) return;
+        if (n_ == 0) { min_ = max_ = x; }
+        else { if (x < min_) min_ = x; if (x > max_) max_ = x; }
+        ++n_;
+        levels_[0].push_back(x);
+        if (++size_ > cap_total_) compress();
+    }
+
+    void merge(const kll_sketch& o) {
+        if (o.n_ == 0) return;
+        if (n_ == 0) { min_ = o.min_; max_ = o.max_; }
+        else { min_ = std::min(min_, o.min_); max_ = std::max(max_, o.max_); }
+        n_ += o.n_;
+        while (levels_.size() < o.levels_.size()) add_level();
+        for (std::size_t h = 0; h < o.levels_.size(); ++h) {
+            levels_[h].insert(levels_[h].end(), o.levels_[h].begin(), o.levels_[h].end());
+            size_ += o.levels_[h].size();
+        }
+        while (size_ > cap_total_) compress();
+    }
+
+    std::uint64_t count()  const noexcept { return n_; }
+    bool          empty()  const noexcept { return n_ == 0; }
+    double        min()    const noexcept { return min_; }
+    double        max()    const noexcept { return max_; }
+    std::uint16_t k()      const noexcept { return k_; }
+    std::size_t   retained() const noexcept { return size_; }
+
+    // Value at normalized rank q in [0,1] (q=0 -> min, q=1 -> max).
+    double quantile(double q) const {
+        const std::vector<double> qs{q};
+        return quantiles(qs)[0];
+    }
+
+    // Several ranks from one sorted view (what the report asks for).
+    std::vector<double> quantiles(const std::vector<double>& qs) const {
+        std::vector<double> out(qs.size(), 0.0);
+        if (n_ == 0) return out;
+
+        std::vector<std::pair<double, std::uint64_t>> view;   // (value, weight)
+        view.reserve(size_);
+        for (std::size_t h = 0; h < levels_.size(); ++h)
+            for (double x : levels_[h]) view.emplace_back(x, std::uint64_t{1} << h);
+        std::sort(view.begin(), view.end(),
+                  [](const auto& a, const auto& b) { return a.first < b.first; });
+
+        std::uint64_t total = 0;
+        for (const auto& v : view) total += v.second;
+
+        for (std::size_t i = 0; i < qs.size(); ++i) {
+            const double q = qs[i];
+            if (q <= 0.0) { out[i] = min_; continue; }
+            if (q >= 1.0) { out[i] = max_; continue; }
+            const double target = q * static_cast<double>(total);
+            std::uint64_t cum = 0;
+            out[i] = view.back().first;
+            for (const auto& v : view) {
+                cum += v.second;
+                if (static_cast<double>(cum) >= target) { out[i] = v.first; break; }
+            }
+        }
+        return out;
+    }
+
+    // Exact state (levels and coin generator), so a loaded sketch continues
+    // as the saved one would have.
+    void save(byte_writer& w) const {
+        w.put(k_);
+        w.put(n_);
+        w.put(min_);
+        w.put(max_);
+        w.put(rng_);
+        w.put<std::uint64_t>(levels_.size());
+        for (const auto& lv : levels_) w.put_vec(lv);
+    }
+    void load(byte_reader& r) {
+        k_   = std::max<std::uint16_t>(8, r.get<std::uint16_t>());
+        n_   = r.get<std::uint64_t>();
+        min_ = r.get<double>();
+        max_ = r.get<double>();
+        rng_ = r.get<std::uint64_t>();
+        const auto h = r.get<std::uint64_t>();
+        if (h == 0 || h > 64) throw std::runtime_error("kll_sketch: bad level count");
+        levels_.clear();
+        size_ = 0;
+        while (levels_.size() < h) add_level();
+        for (auto& lv : levels_) { lv = r.get_vec<double>(); size_ += lv.size(); }
+    }
+
+private:
+    // Level h of H holds at most k * (2/3)^(H-1-h) items (at least 2).
+    std::size_t capacity(std::size_t h) const {
+        const std::size_t depth = levels_.size() - 1 - h;
+        const double c = static_cast<double>(k_) * std::pow(2.0 / 3.0, static_cast<double>(depth));
+        return std::max<std::size_t>(2, static_cast<std::size_t>(std::ceil(c)));
+    }
+    // Capacities only change when a level is added, so they are cached.
+    void add_level() {
+        levels_.emplace_back();
+        caps_.resize(levels_.size());
+        cap_total_ = 0;
+        for (std::size_t h = 0; h < levels_.size(); ++h) cap_total_ += caps_[h] = capacity(h);
+    }
+
+    bool coin() {
+        // xorshift64
+        rng_ ^= rng_ << 13;
+        rng_ ^= rng_ >> 7;
+        rng_ ^= rng_ << 17;
+        return (rng_ & 1u) != 0;
+    }
+
+    void compress() {
+        for (std::size_t h = 0; h < levels_.size(); ++h) {
+            if (levels_[h].size() < caps_[h]) continue;
+            if (h + 1 == levels_.size()) add_level();
+
+            std::vector<double>& lv = levels_[h];
+            std::sort(lv.begin(), lv.end());
+            // an odd item out stays behind at this level
+            double keep = 0.0;
+            const bool odd = (lv.size() % 2) != 0;
+            if (odd) { keep = lv.back(); lv.pop_back(); }
+
+            std::vector<double>& up = levels_[h + 1];
+            const std::size_t off = coin() ? 1 : 0;
+            for (std::size_t i = off; i < lv.size(); i += 2) up.push_back(lv[i]);
+            size_ -= lv.size() / 2;
+            lv.clear();
+            if (odd) lv.push_back(keep);
+            return;
+        }
+    }
+
+    std::uint16_t                    k_;
+    std::vector<std::vector<double>> levels_;
+    std::vector<std::size_t>         caps_;
+    std::size_t                      cap_total_ = 0;
+    std::size_t                      size_ = 0;
+    std::uint64_t                    n_    = 0;
+    double                           min_  = 0.0;
+    double                           max_  = 0.0;
+    std::uint64_t                    rng_  = 0x9E3779B97F4A7C15ull;
+};
+
+}
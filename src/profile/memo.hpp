@@ -0,0 +1,124 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "../types/parse_date.hpp"
+#include "../types/parse_number.hpp"
+
+namespace csvqr {
+
+// What the type kernel learns about one trimmed cell. Only the checks the
+// column still needed when the verdict was made are filled in; candidates
+// only shrink, so a cached verdict never lacks a check asked of it later.
+struct cell_verdict {
+    bool                      null    = false;
+    bool                      is_bool = false;
+    numeric_value             num;             // kind none: not a number (or not checked)
+    std::optional<date_value> date;
+    std::uint32_t             topk_slot = 0;   // hint for space_saving::add_hinted
+};
+
+// Per-column memo of cell verdicts, keyed by the 64-bit hash of the trimmed
+// bytes (the hash the distinct/top-k sketches need anyway). Each key has two
+// candidate slots (low and high hash bits), so a few hundred distinct values
+// live side by side without thrashing. Keys up to max_key bytes are stored and
+// compared in full, so a hit is exact; longer cells are never cached.
+// Repetitive columns (codes, flags, dates) then skip null matching and value
+// parsing on almost every cell, and a hit also means the distinct-count
+// sketch has already seen the value. Every `window` lookups the hit rate of
+// that window is checked, and a column that stays below min_hit_pct turns its
+// memo off for good and releases it.
+class verdict_cache {
+public:
+    static constexpr std::size_t   max_key     = 23;
+    static constexpr std::size_t   slots       = 256;
+    static constexpr std::uint32_t window      = 4096;
+    static constexpr std::uint32_t min_hit_pct = 50;
+
+    bool enabled() const noexcept { return enabled_; }
+
+    // nullptr on a miss; the caller computes the verdict and store()s it.
+    // The returned verdict stays valid until the next store().
+    cell_verdict* find(std::string_view key, std::uint64_t h) noexcept {
+        if (window_n_ == window) end_window();
+        ++window_n_;
+        ++lookups_;
+        cell_verdict* hit = nullptr;
+        if (key.size() <= max_key && !table_.empty()) {
+            entry* e = &table_[slot_a(h)];
+            if (!e->holds(key, h)) e = &table_[slot_b(h)];
+            if (e->holds(key, h)) {
+                ++hits_;
+                ++window_hits_;
+                hit = &e->v;
+            }
+        }
+        return hit;
+    }
+
+    cell_verdict& store(std::string_view key, std::uint64_t h, const cell_verdict& v) {
+        if (key.size() > max_key || !enabled_) { spare_ = v; return spare_; }
+        if (table_.empty()) table_.resize(slots);
+        entry* e = &table_[slot_a(h)];
+        if (e->len != empty_len) {
+            entry* b = &table_[slot_b(h)];
+            if (b->len == empty_len || (h >> 63)) e = b;   // both taken: evict either
+        }
+        store_at(*e, key, h, v);
+        return e->v;
+    }
+
+    std::uint64_t lookups() const noexcept { return lookups_; }
+    std::uint64_t hits()    const noexcept { return hits_; }
+
+    // Counters of another column state folded into this one (merge).
+    void add_counts(const verdict_cache& o) noexcept { lookups_ += o.lookups_; hits_ += o.hits_; }
+
+private:
+    static constexpr std::uint8_t empty_len = 0xFF;   // no key is this long
+
+    struct entry {
+        std::uint64_t hash = 0;
+        std::uint8_t  len  = empty_len;
+        char          key[max_key];
+        cell_verdict  v;
+
+        bool holds(std::string_view k, std::uint64_t h) const noexcept {
+            // empty keys may have a null data() (padding of short rows)
+            return hash == h && len == k.size() && (k.empty() || std::memcmp(key, k.data(), k.size()) == 0);
+        }
+    };
+
+    static std::size_t slot_a(std::uint64_t h) noexcept { return static_cast<std::size_t>(h) & (slots - 1); }
+    static std::size_t slot_b(std::uint64_t h) noexcept { return static_cast<std::size_t>(h >> 32) & (slots - 1); }
+
+    static void store_at(entry& e, std::string_view key, std::uint64_t h, const cell_verdict& v) noexcept {
+        e.hash = h;
+        e.len  = static_cast<std::uint8_t>(key.size());
+        if (!key.empty()) std::memcpy(e.key, key.data(), key.size());
+        e.v = v;
+    }
+
+    void end_window() {
+        if (window_hits_ * 100 < std::uint64_t{window} * min_hit_pct) {
+            enabled_ = false;
+            std::vector<entry>().swap(table_);
+        }
+        window_n_ = 0;
+        window_hits_ = 0;
+    }
+
+    bool               enabled_     = true;
+    std::uint32_t      window_n_    = 0;
+    std::uint64_t      window_hits_ = 0;
+    std::uint64_t      lookups_     = 0;
+    std::uint64_t      hits_        = 0;
+    std::vector<entry> table_;              // allocated on first store
+    cell_verdict       spare_;              // verdicts that are not cached
+};
+
+}
@@ -0,0 +1,136 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "../csv/parallel_count.hpp"
+#include "../csv/record_splitter.hpp"
+#include "profile.hpp"
+
+namespace csvqr {
+
+// Per range of a parallel run: its wall time and the part of it spent in
+// the type kernels (what is left is mostly tokenizing).
+struct range_timings {
+    std::vector<std::uint64_t> total_ns, kernel_ns;
+};
+
+struct parallel_profile_result {
+    ProfileResult profile;
+    std::uint64_t records = 0;   // logical records seen, header included
+};
+
+// Parallel column profiling over an in-memory buffer (typically a mapped
+// file) cut at record starts (parts + 1 non-decreasing offsets, from
+// speculative_scan::record_starts or row_index::record_starts): each range is
+// profiled by its own column_profiler on its own thread; the profilers are
+// then merged left to right into `into` (a fresh profiler built with
+// header_present and popt, which profiles the first non-empty range itself,
+// so the header stays with it whatever the cuts). Returns
+// the logical records seen, header included. Counts and type verdicts equal a
+// single-threaded run exactly; quantiles, top-k and distinct counts are
+// merged sketches (same bounds).
+inline std::uint64_t profile_parallel_into(column_profiler& into,
+                                           std::string_view data,
+                                           const std::vector<std::size_t>& starts,
+                                           char delim,
+                                           char quote,
+                                           bool header_present,
+                                           const profile_options& popt = {},
+                                           range_timings* timings = nullptr) {
+    const std::size_t parts = starts.size() - 1;
+    if (timings) {
+        timings->total_ns.assign(parts, 0);
+        timings->kernel_ns.assign(parts, 0);
+    }
+    if (data.empty()) return 0;
+    std::size_t lead = 0;   // the range holding offset 0 (cuts can leave empty ranges before it)
+    while (lead + 1 < parts && starts[lead] == starts[lead + 1]) ++lead;
+
+    // only the lead range can hold the header; the others take the column
+    // layout (names, projection) from the first record up front
+    std::string_view first = data.substr(0, next_record_start(data, 1, data[0] == quote, quote));
+    if (first.size() >= 2 && first.substr(first.size() - 2) == "\r\n") first.remove_suffix(2);
+    else if (!first.empty() && (first.back() == '\n' || first.back() == '\r')) first.remove_suffix(1);
+
+    std::vector<std::optional<column_profiler>> profs(parts);
+    std::vector<std::uint64_t> records(parts, 0);
+    for (std::size_t i = lead + 1; i < parts; ++i) {
+        profs[i].emplace(delim, quote, false, popt);
+        profs[i]->preset_layout(first, header_present);
+    }
+    {
+        std::vector<std::thread> pool;
+        pool.reserve(parts);
+        for (std::size_t i = 0; i < parts; ++i) {
+            if (starts[i] == starts[i + 1]) continue;
+            pool.emplace_back([&, i] {
+                WallTimer t;
+                t.start();
+                column_profiler& prof = i == lead ? into : *profs[i];
+                const std::uint64_t kernel_before = prof.kernel_spans().total_ns();
+                const std::string_view range = data.substr(starts[i], starts[i + 1] - starts[i]);
+                record_splitter split(quote);
+                auto on_record = [&](std::string_view rec){ prof.add_record(rec); ++records[i]; };
+                prof.begin_chunk(range);
+                split.feed(range, on_record);
+                split.finish(on_record);
+                prof.end_batch();
+                t.stop();
+                if (timings) {
+                    timings->total_ns[i]  = t.ns();
+                    timings->kernel_ns[i] = prof.kernel_spans().total_ns() - kernel_before;
+                }
+            });
+        }
+        for (auto& t : pool) t.join();
+    }
+
+    std::uint64_t total = 0;
+    for (std::size_t i = lead + 1; i < parts; ++i) into.merge(*profs[i]);
+    for (std::uint64_t r : records) total += r;
+    return total;
+}
+
+// The speculative count pass already resolved the quote state at every cut,
+// so each range is advanced to its first record start.
+inline std::uint64_t profile_parallel_into(column_profiler& into,
+                                           std::string_view data,
+                                           const speculative_scan& sc,
+                                           char delim,
+                                           char quote,
+                                           bool header_present,
+                                           const profile_options& popt = {},
+                                           range_timings* timings = nullptr) {
+    return profile_parallel_into(into, data, sc.record_starts(data, quote), delim, quote, header_present, popt, timings);
+}
+
+inline parallel_profile_result profile_parallel(std::string_view data,
+                                                const speculative_scan& sc,
+                                                char delim,
+                                                char quote,
+                                                bool header_present,
+                                                const profile_options& popt = {}) {
+    column_profiler prof(delim, quote, header_present, popt);
+    parallel_profile_result out;
+    out.records = profile_parallel_into(prof, data, sc, delim, quote, header_present, popt);
+    out.profile = prof.finish();
+    return out;
+}
+
+// Convenience form: runs the speculative pass itself.
+inline parallel_profile_result profile_parallel(std::string_view data,
+                                                char delim,
+                                                char quote,
+                                                bool header_present,
+                                                const profile_options& popt = {},
+                                                int threads = 0,
+                                                std::size_t min_bytes_per_thread = 1u << 20) {
+    const speculative_scan sc = scan_speculative(data, delim, quote,
+                                                 parallel_parts(data.size(), threads, min_bytes_per_thread));
+    return profile_parallel(data, sc, delim, quote, header_present, popt);
+}
+
+}
@@ -1,26 +1,77 @@
 // src/profile/profile.hpp
 #pragma once
 #include <cstdint>
+#include <optional>
+#include <utility>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <array>
+#include <limits>
 #include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include "../csv/record_splitter.hpp"
+#include "../csv/record_view.hpp"
+#include "../csv/tokenizer.hpp"
+#include "../util/arena.hpp"
+#include "../util/hash.hpp"
+#include "../util/nulls.hpp"
+#include "../types/infer.hpp"
+#include "../types/parse_date.hpp"
+#include "../types/parse_number.hpp"
+#include "profiler.hpp"
+#include "column_batch.hpp"
+#include "memo.hpp"
+#include "../util/serial.hpp"
+#include "../io/chunk_reader.hpp"
+#include "../metrics/span_histogram.hpp"
 
 namespace csvqr {
 
 // ---------- data model ----------
 struct ColumnSummary {
     std::string  name;
-    std::string  logical_type;      // "bool" | "int" | "float" | "date" | "string"
+    std::string  logical_type;      // "bool" | "int" | "float" | "date" | "datetime" | "string"
     std::uint64_t null_count      = 0;
     std::uint64_t non_null_count  = 0;
+    std::optional<std::pair<std::uint64_t, std::uint64_t>> null_count_ci;   // sampled runs: 95% interval
+
+    // numeric columns ("int" / "float") only
+    std::optional<double> min, max, mean, stddev, median;
+    std::vector<std::pair<double, double>> quantiles;   // (q, value), from the KLL sketch
+    std::optional<histogram> hist;                      // streaming, at most hist_bins bins
+    std::optional<std::int64_t> min_int, max_int;   // exact bounds of "int" columns
+    std::optional<std::string>  min_text, max_text; // ISO bounds of "date" / "datetime" columns
+
+    std::optional<std::uint64_t> cardinality;        // distinct non-null values (HLL estimate)
+
+    // most frequent values; true count is in [count - error, count]
+    struct top_value { std::string value; std::uint64_t count = 0, error = 0; };
+    std::vector<top_value> topk;
+};
+
+// How a sampled profile was drawn; rows and null counts are then estimates.
+struct sample_info {
+    std::uint64_t blocks = 0;           // blocks profiled
+    std::uint64_t rows = 0;             // data rows actually profiled
+    double        fraction = 0.0;       // share of the data bytes profiled
+    std::uint64_t rows_lo = 0, rows_hi = 0;   // 95% interval of the row count
 };
 
 struct ProfileResult {
     std::vector<ColumnSummary> columns;
     std::uint64_t rows = 0;
+    std::optional<sample_info> sample;   // set by profile_sampled
+    std::uint64_t memo_lookups = 0, memo_hits = 0;   // verdict memo, all columns
+    // arenas: peak of the per-batch scratch (cells needing unescaping, records
+    // outside the current chunk) and the long-lived top-k key pools
+    std::uint64_t scratch_arena_bytes = 0, key_arena_bytes = 0, interned_keys = 0;
 };
 
 // ---------- small helpers ----------
@@ -34,7 +85,17 @@ inline std::string rtrim(std::string s){
 }
 inline std::string trim(std::string s){ return rtrim(ltrim(std::move(s))); }
 
-inline bool ieq(const std::string& a, const std::string& b){
+// Trimming by pointer adjustment (no copy); same character set as C-locale isspace.
+inline bool is_space_c(char c){
+    return c==' ' || c=='\t' || c=='\n' || c=='\r' || c=='\v' || c=='\f';
+}
+inline std::string_view trim_view(std::string_view s){
+    while (!s.empty() && is_space_c(s.front())) s.remove_prefix(1);
+    while (!s.empty() && is_space_c(s.back()))  s.remove_suffix(1);
+    return s;
+}
+
+inline bool ieq(std::string_view a, std::string_view b){
     if (a.size() != b.size()) return false;
     for (size_t i=0;i<a.size();++i){
         unsigned char ca = static_cast<unsigned char>(a[i]);
@@ -44,65 +105,33 @@ inline bool ieq(const std::string& a, const std::string& b){
     return true;
 }
 
-// very small date detector: YYYY-MM-DD [T| ]HH:MM:SS(Z)? | YYYY-MM-DD | MM/DD/YYYY
-inline bool is_date_like(const std::string& s){
-    const std::string t = trim(s);
-    if (t.size() >= 10) {
-        // YYYY-MM-DD
-        if (std::isdigit(t[0])&&std::isdigit(t[1])&&std::isdigit(t[2])&&std::isdigit(t[3]) &&
-            t[4]=='-' &&
-            std::isdigit(t[5])&&std::isdigit(t[6]) &&
-            t[7]=='-' &&
-            std::isdigit(t[8])&&std::isdigit(t[9])) {
-            return true; // good enough for MVP (accept optional time suffix)
-        }
-    }
-    if (t.size() >= 8) {
-        // MM/DD/YYYY
-        if (std::isdigit(t[0]) && (std::isdigit(t[1]) || t[1]=='/') ) {
-            size_t p1 = t.find('/'); if (p1!=std::string::npos){
-                size_t p2 = t.find('/', p1+1);
-                if (p2!=std::string::npos && p2+5<=t.size() &&
-                    std::isdigit(t[p2+1])&&std::isdigit(t[p2+2])&&
-                    std::isdigit(t[p2+3])&&std::isdigit(t[p2+4])) {
-                    return true;
-                }
-            }
-        }
-    }
-    return false;
+inline bool is_digit_c(char c){ return c>='0' && c<='9'; }
+
+// date or datetime in one of the default formats (validated; see types/parse_date.hpp)
+inline bool is_date_like(std::string_view s){
+    static const date_parser parser;
+    return parser.parse(trim_view(s)).has_value();
 }
 
-inline bool is_bool_like(const std::string& s){
-    const std::string t = trim(s);
-    static const char* k[] = {"true","false","1","0","yes","no"};
-    for (auto* w: k) if (ieq(t, w)) return true;
+inline bool is_bool_like(std::string_view s){
+    const std::string_view t = trim_view(s);
+    if (t.empty() || t.size() > 5) return false;
+    static constexpr std::string_view k[] = {"true","false","1","0","yes","no"};
+    for (auto w: k) if (ieq(t, w)) return true;
     return false;
 }
-inline bool is_int64_like(const std::string& s){
-    const std::string t = trim(s);
-    if (t.empty()) return false;
-    size_t i = (t[0]=='+'||t[0]=='-') ? 1 : 0;
-    if (i>=t.size()) return false;
-    for (; i<t.size(); ++i) if (!std::isdigit(static_cast<unsigned char>(t[i]))) return false;
-    return true; // (range check omitted for MVP)
-}
-inline bool is_float_like(const std::string& s){
-    // allow decimals and scientific notation; rely on strtod acceptance
-    const std::string t = trim(s);
-    if (t.empty()) return false;
-    char* end = nullptr;
-#if defined(_WIN32)
-    double v = _strtod_l(t.c_str(), &end, nullptr);
-#else
-    double v = std::strtod(t.c_str(), &end);
-#endif
-    (void)v;
-    return end && end != t.c_str() && *end == '\0';
+inline bool is_int64_like(std::string_view s){
+    std::int64_t v;
+    return parse_int64(trim_view(s), v);    // range-checked: overflow is not an int
+}
+inline bool is_float_like(std::string_view s){
+    // decimals, scientific notation, inf/nan; overflowing integers land here
+    double v;
+    return parse_float64(trim_view(s), v);
 }
 
 // ---------- tiny CSV line parser (RFC4180-ish, covers quotes) ----------
-inline std::vector<std::string> parse_csv_line(const std::string& line, char delim, char quote){
+inline std::vector<std::string> parse_csv_line(std::string_view line, char delim, char quote){
     std::vector<std::string> out;
     std::string cur;
     bool inq = false;
@@ -127,119 +156,615 @@ inline std::vector<std::string> parse_csv_line(const std::string& line, char del
     return out;
 }
 
+// What the column profiler looks for (config [nulls] / [types]).
+struct profile_options {
+    std::vector<std::string> null_tokens      = default_null_tokens();
+    std::vector<std::string> date_formats     = default_date_formats();
+    std::vector<std::string> datetime_formats = default_datetime_formats();
+    std::vector<double>      quantiles        = {0.5, 0.95};   // reported for numeric columns
+    std::uint16_t            quantile_k       = 200;           // KLL accuracy/size knob
+    int                      hist_bins        = 32;            // max histogram bins (numeric columns)
+    std::size_t              topk             = 20;            // values reported; 0 = off
+    std::size_t              topk_counters    = 0;             // Space-Saving slots; 0 = 4 * topk
+    unsigned                 hll_precision    = 12;            // distinct counts: 2^p bytes, ~1.04/sqrt(2^p) error
+    std::vector<std::string> include_columns;                  // [columns]: empty = every column
+    std::vector<std::string> exclude_columns;
+    std::vector<std::pair<std::string, std::string>> forced_types;   // [types] force: column -> type name
+    std::size_t              batch_rows       = 4096;
+};
+
 // ---------- profile core ----------
-inline ProfileResult profile_csv_file(const std::string& path,
-                                      char delim,
-                                      char quote,
-                                      bool header_present,
-                                      const std::vector<std::string>& null_tokens = {"", "NA", "N/A", "null", "NULL", "NaN"})
-{
-    std::ifstream is(path, std::ios::binary);
-    ProfileResult pr{};
-    if (!is) return pr;
-
-    std::string line;
-    std::vector<std::string> header;
-    bool header_read = false;
-    std::vector<std::string> names;
-
-    // type trackers per column
-    struct TState {
-        bool all_bool  = true;
-        bool all_int   = true;
-        bool all_float = true;
-        bool all_date  = true;
-        std::uint64_t nulls = 0, non_nulls = 0;
-    };
-    std::vector<TState> states;
-
-    auto is_null_like = [&](const std::string& v)->bool{
-        const std::string t = trim(v);
-        for (auto& tok : null_tokens){
-            if (ieq(t, tok)) return true;
+// per-column type tracker
+struct column_state {
+    // candidate types (see types/infer.hpp): a type stays while every value
+    // so far parses as it; "date" means a date-only format matched each time
+    std::uint8_t types  = type_bits::all;
+    bool         forced = false;         // [types] force: fixed type, values parsed, nothing ruled out
+    std::uint64_t nulls = 0, non_nulls = 0;
+
+    bool can(std::uint8_t t) const noexcept { return (types & t) != 0; }
+    void rule_out(std::uint8_t t) noexcept { types = csvqr::rule_out(types, t); }
+
+    // fed while the column still parses as numeric
+    numeric_stats num;
+    categorical_stats cat;               // frequent values (every non-null cell)
+    bool          track_topk = false;
+    hll_sketch    distinct;              // every non-null cell
+    verdict_cache memo;                  // per-value verdicts while the column repeats itself
+    std::int64_t  imin = 0, imax = 0;    // exact bounds while int64 is a candidate
+
+    // fed while the column still parses as a date/datetime
+    std::size_t   date_hint = 0;         // index of the format that matched last
+    std::int64_t  tmin = 0, tmax = 0;    // epoch seconds
+    std::uint64_t dates = 0;
+
+    std::uint64_t first_row = 0;         // data rows the profiler had seen before this column appeared
+
+    // Folds in the state of the same column over other rows. Verdicts and
+    // counts are exact (order does not matter for "all values are X");
+    // bounds are only combined while both sides can still use them.
+    void merge(const column_state& o){
+        if (can(type_bits::int64) && o.can(type_bits::int64) && o.num.non_null_count > 0){
+            if (num.non_null_count == 0){ imin = o.imin; imax = o.imax; }
+            else { imin = std::min(imin, o.imin); imax = std::max(imax, o.imax); }
         }
+        if (can(type_bits::datetime) && o.can(type_bits::datetime) && o.dates > 0){
+            if (dates == 0){ tmin = o.tmin; tmax = o.tmax; }
+            else { tmin = std::min(tmin, o.tmin); tmax = std::max(tmax, o.tmax); }
+        }
+        dates += o.dates;
+        types &= o.types;
+        nulls     += o.nulls;
+        non_nulls += o.non_nulls;
+        num.merge(o.num);
+        if (track_topk && o.track_topk) cat.merge(o.cat);
+        distinct.merge(o.distinct);
+        memo.add_counts(o.memo);
+    }
+
+    // Everything but the memo, which only saves work and starts over empty.
+    void save(byte_writer& w) const {
+        w.put(types); w.put(forced);
+        w.put(nulls); w.put(non_nulls);
+        num.save(w);
+        w.put(track_topk);
+        if (track_topk) cat.save(w);
+        distinct.save(w);
+        w.put(imin); w.put(imax);
+        w.put<std::uint64_t>(date_hint);
+        w.put(tmin); w.put(tmax); w.put(dates);
+        w.put(first_row);
+    }
+    void load(byte_reader& r){
+        types = r.get<std::uint8_t>(); forced = r.get<bool>();
+        nulls = r.get<std::uint64_t>(); non_nulls = r.get<std::uint64_t>();
+        num.load(r);
+        track_topk = r.get<bool>();
+        if (track_topk) cat.load(r);
+        distinct.load(r);
+        imin = r.get<std::int64_t>(); imax = r.get<std::int64_t>();
+        date_hint = static_cast<std::size_t>(r.get<std::uint64_t>());
+        tmin = r.get<std::int64_t>(); tmax = r.get<std::int64_t>(); dates = r.get<std::uint64_t>();
+        first_row = r.get<std::uint64_t>();
+    }
+};
+
+template <class Pred>
+inline bool all_of_cells(const std::string_view* v, std::size_t n, Pred&& pred){
+    for (std::size_t i=0;i<n;++i) if (!pred(v[i])) return false;
+    return true;
+}
+
+// One value of a column that still has float64 (or is forced numeric);
+// false once the column is no longer numeric.
+inline bool feed_number(column_state& st, const numeric_value& x){
+    if (st.forced){
+        if (!x || (st.can(type_bits::int64) && !x.is_int())) return true;
+    } else if (!x){ st.rule_out(type_bits::float64); return false; }
+    if (st.can(type_bits::int64)){
+        if (!x.is_int()) st.rule_out(type_bits::int64);
+        else if (st.num.non_null_count == 0){ st.imin = st.imax = x.i; }
+        else { st.imin = std::min(st.imin, x.i); st.imax = std::max(st.imax, x.i); }
+    }
+    st.num.add(x.d);
+    return true;
+}
+
+// Same for datetime: false once the column is no longer a date/datetime.
+inline bool feed_date(column_state& st, const std::optional<date_value>& d){
+    if (!d){
+        if (st.forced) return true;
+        st.rule_out(type_bits::datetime);
         return false;
-    };
-
-    while (std::getline(is, line)){
-        // handle CRLF
-        if (!line.empty() && line.back()=='\r') line.pop_back();
-
-        auto fields = parse_csv_line(line, delim, quote);
-        if (!header_read){
-            header_read = true;
-            if (header_present){
-                header = fields;
-                if (header.empty()) continue;
-                names = header;
-            } else {
-                // synthesize names from first row's width
-                names.resize(fields.size());
-                for (size_t i=0;i<fields.size();++i){
-                    names[i] = "col" + std::to_string(i+1);
-                }
-                // and process this first line as data
-                header = names;
-                header_read = true;
+    }
+    if (d->has_time && !st.forced) st.rule_out(type_bits::date);
+    if (st.dates++ == 0){ st.tmin = st.tmax = d->seconds; }
+    else { st.tmin = std::min(st.tmin, d->seconds); st.tmax = std::max(st.tmax, d->seconds); }
+    return true;
+}
+
+// Memoized kernel (see verdict_cache): cell by cell, each distinct short
+// value is null-matched and parsed once while it stays in the memo, and its
+// top-k entry is remembered. Verdicts are applied in row order, so the result
+// equals the batch kernel's.
+template <class IsNull>
+inline void profile_column_cells_memo(column_state& st, const std::string_view* cells, std::size_t n,
+                                      IsNull&& is_null, const date_parser& dates){
+    for (std::size_t i=0;i<n;++i){
+        const std::string_view t = trim_view(cells[i]);
+        const std::uint64_t h = hash64(t);
+        cell_verdict* v = st.memo.find(t, h);
+        const bool seen = v != nullptr;
+        if (!seen){
+            cell_verdict fresh;
+            fresh.null = is_null(t);
+            if (!fresh.null){
+                if (st.can(type_bits::boolean) && !st.forced) fresh.is_bool = is_bool_like(t);
+                if (st.can(type_bits::float64))  fresh.num  = parse_numeric(t);
+                if (st.can(type_bits::datetime)) fresh.date = dates.parse(t, st.date_hint);
+                fresh.topk_slot = static_cast<std::uint32_t>(space_saving::npos);
             }
-            states.resize(header.size());
-            if (!header_present){
-                // process data row (fields already parsed)
-            } else {
-                // continue to next line for data
-                ++pr.rows; // count header row? Usually not; we won't. So revert:
-                --pr.rows;
-                continue;
+            v = &st.memo.store(t, h, fresh);
+        }
+        if (v->null){ ++st.nulls; continue; }
+        ++st.non_nulls;
+        if (!seen) st.distinct.add_hash(h);   // a memo hit was added when it was stored
+        if (st.track_topk) v->topk_slot = static_cast<std::uint32_t>(st.cat.add_hinted(t, h, v->topk_slot));
+        if (st.can(type_bits::boolean) && !st.forced && !v->is_bool) st.rule_out(type_bits::boolean);
+        if (st.can(type_bits::float64))  feed_number(st, v->num);
+        if (st.can(type_bits::datetime)) feed_date(st, v->date);
+    }
+}
+
+// Type kernel for one column of a batch. `vals` is scratch: it receives the
+// trimmed non-null cells, then each still-possible type is checked over that
+// contiguous array in its own loop. A type ruled out earlier costs nothing, so
+// once a column has reached string only counting and the sketches remain.
+// Forced columns skip the checks: values are parsed for their statistics and
+// cells that do not parse as the forced type are left out of them.
+// Columns go through the memo instead while it pays off.
+template <class IsNull>
+inline void profile_column_cells(column_state& st, const std::string_view* cells, std::size_t n,
+                                 IsNull&& is_null, const date_parser& dates,
+                                 std::vector<std::string_view>& vals){
+    if (st.memo.enabled()){
+        profile_column_cells_memo(st, cells, n, is_null, dates);
+        return;
+    }
+    vals.clear();
+    for (std::size_t i=0;i<n;++i){
+        const std::string_view t = trim_view(cells[i]);
+        if (is_null(t)) continue;
+        vals.push_back(t);
+    }
+    const std::size_t nn = vals.size();
+    st.nulls     += n - nn;
+    st.non_nulls += nn;
+    if (nn == 0) return;
+
+    const std::string_view* v = vals.data();
+    // one hash per cell feeds both the distinct-count and the top-k sketch
+    for (std::size_t i=0;i<nn;++i){
+        const std::uint64_t h = hash64(v[i]);
+        st.distinct.add_hash(h);
+        if (st.track_topk) st.cat.add(v[i], h);
+    }
+    if (st.types == 0) return;
+    if (st.can(type_bits::boolean) && !st.forced &&
+        !all_of_cells(v, nn, [](std::string_view x){ return is_bool_like(x); }))
+        st.rule_out(type_bits::boolean);
+    if (st.can(type_bits::float64)) {
+        // one parse per cell gives the int/float verdict and the value for the stats
+        for (std::size_t i=0;i<nn;++i)
+            if (!feed_number(st, parse_numeric(v[i]))) break;
+    }
+    if (st.can(type_bits::datetime)) {
+        for (std::size_t i=0;i<nn;++i)
+            if (!feed_date(st, dates.parse(v[i], st.date_hint))) break;
+    }
+}
+
+// Streaming column profiler: fed one logical record at a time (no line
+// terminator), so any record source can drive it (file scan, fused scan, ...).
+// Records are tokenized into a column_batch of up to batch_rows rows; the
+// type kernels run per column when the batch fills, at end_batch() and at
+// finish().
+//
+// Cells are views, so they must outlive the batch: records inside the window
+// passed to begin_chunk() are referenced in place (until end_batch()), any
+// other record is copied into the profiler's arena first.
+//
+// With include/exclude columns set, the header (or the synthesized colN names)
+// is resolved once into a field mask for the tokenizer: unselected fields never
+// reach the batch or the kernels, and only selected columns are reported.
+class column_profiler {
+public:
+    column_profiler(char delim,
+                    char quote,
+                    bool header_present,
+                    profile_options opt = {})
+        : delim_(delim), quote_(quote), header_present_(header_present),
+          nulls_(opt.null_tokens),
+          dates_(opt.date_formats, opt.datetime_formats),
+          quantiles_(std::move(opt.quantiles)), quantile_k_(opt.quantile_k), hist_bins_(opt.hist_bins),
+          topk_(opt.topk), topk_counters_(opt.topk_counters ? opt.topk_counters : 4 * opt.topk),
+          hll_precision_(opt.hll_precision),
+          include_(std::move(opt.include_columns)), exclude_(std::move(opt.exclude_columns)),
+          forced_(std::move(opt.forced_types)),
+          project_(!include_.empty() || !exclude_.empty()),
+          batch_(opt.batch_rows) {}
+
+    // The caller guarantees `chunk` stays alive until end_batch().
+    void begin_chunk(std::string_view chunk) noexcept { source_ = chunk; }
+
+    void add_record(std::string_view line){
+        if (!in_source(line)) line = scratch_.store(line);
+        tok_.tokenize(line, rec_, scratch_);
+        if (!header_read_){
+            header_read_ = true;
+            if (header_present_){
+                set_layout(std::vector<std::string>(rec_.fields.begin(), rec_.fields.end()));
+                return; // header is not a data row
             }
+            // synthesize names from first row's width, then process it as data
+            set_layout(synth_names(0, rec_.size()));
+            if (project_) tok_.tokenize(line, rec_, scratch_);
         }
 
         // data row
-        ++pr.rows;
-        if (states.empty()){
-            names.resize(fields.size());
-            for (size_t i=0;i<fields.size();++i) names[i] = "col" + std::to_string(i+1);
-            states.resize(fields.size());
-        }
-
-        // normalize width (short/long rows)
-        if (fields.size() < states.size()) fields.resize(states.size());
-        if (fields.size() > states.size()){
-            // expand states/names to fit widest row (rare but possible)
-            size_t old = states.size();
-            states.resize(fields.size());
-            for (size_t i=old;i<fields.size();++i) names.push_back("col" + std::to_string(i+1));
-        }
-
-        for (size_t c=0;c<fields.size();++c){
-            const std::string& raw = fields[c];
-            if (is_null_like(raw)){ states[c].nulls++; continue; }
-            states[c].non_nulls++;
-
-            const std::string t = trim(raw);
-            if (!is_bool_like(t))  states[c].all_bool  = false;
-            if (!is_int64_like(t)) states[c].all_int   = false;
-            if (!is_float_like(t)) states[c].all_float = false;
-            if (!is_date_like(t))  states[c].all_date  = false;
-        }
-    }
-
-    // finalize
-    pr.columns.resize(states.size());
-    for (size_t i=0;i<states.size(); ++i){
-        auto& cs = pr.columns[i];
-        cs.name = (i < names.size() && !names[i].empty()) ? names[i] : ("col"+std::to_string(i+1));
-        cs.null_count = states[i].nulls;
-        cs.non_null_count = states[i].non_nulls;
-
-        // choose type by “all values are X” priority
-        if (cs.non_null_count == 0)        cs.logical_type = "string";
-        else if (states[i].all_bool)       cs.logical_type = "bool";
-        else if (states[i].all_int)        cs.logical_type = "int";
-        else if (states[i].all_float)      cs.logical_type = "float";
-        else if (states[i].all_date)       cs.logical_type = "date";
-        else                               cs.logical_type = "string";
-    }
-    return pr;
+        ++rows_;
+
+        // expand states/names to fit widest row (rare but possible); columns
+        // added here start counting at this row
+        if (rec_.size() > states_.size()){
+            run_kernels();
+            if (project_) widen_projection(line);
+            else {
+                const auto extra = synth_names(states_.size(), rec_.size());
+                names_.insert(names_.end(), extra.begin(), extra.end());
+                grow_states(rec_.size(), rows_ - 1);
+                batch_.set_width(rec_.size());
+            }
+        }
+
+        // short rows: missing trailing fields count as empty
+        batch_.append(rec_);
+        if (batch_.full()) flush();
+    }
+
+    // Profiles what is buffered and releases the chunk/arena bytes it referenced.
+    void end_batch(){
+        flush();
+        source_ = {};
+    }
+
+    std::uint64_t rows() const noexcept { return rows_; }
+
+    // Time in the type kernels, one span per batch (merged profilers included).
+    const span_histogram& kernel_spans() const noexcept { return kernel_spans_; }
+
+    // Nulls seen so far per column, as of the last end_batch().
+    std::vector<std::uint64_t> null_counts() const {
+        std::vector<std::uint64_t> out(states_.size());
+        for (std::size_t c=0; c<states_.size(); ++c) out[c] = states_[c].nulls;
+        return out;
+    }
+
+    // Fixes the column layout from the input's first record without consuming
+    // it, so a profiler that starts mid-file (a later parallel range) resolves
+    // names and the column projection exactly as the first one does.
+    void preset_layout(std::string_view first_record, bool is_header){
+        tok_.tokenize(first_record, rec_, scratch_);
+        header_read_ = true;
+        set_layout(is_header ? std::vector<std::string>(rec_.fields.begin(), rec_.fields.end())
+                             : synth_names(0, rec_.size()));
+        scratch_.reset();
+    }
+
+    // Columnar input (snapshots): fixes the layout from the source column
+    // names as a header would (projection and forced types apply) and sets
+    // the data row count. The caller then fills each selected column's state
+    // itself, through source_column() and profile_cells().
+    void preset_columns(const std::vector<std::string>& names, std::uint64_t rows){
+        header_read_ = true;
+        set_layout(names);
+        rows_ = rows;
+    }
+
+    // State of source column i, or nullptr if the projection drops it.
+    column_state* source_column(std::size_t i){
+        if (!project_) return i < states_.size() ? &states_[i] : nullptr;
+        if (i >= keep_.size() || !keep_[i]) return nullptr;
+        return &states_[static_cast<std::size_t>(std::count(keep_.begin(), keep_.begin() + i, std::uint8_t{1}))];
+    }
+
+    // The type kernel over n text cells of one column, with this profiler's
+    // null tokens and date formats; `scratch` is the caller's (one per thread).
+    void profile_cells(column_state& st, const std::string_view* cells, std::size_t n,
+                       std::vector<std::string_view>& scratch) const {
+        profile_column_cells(st, cells, n, nulls_, dates_, scratch);
+    }
+
+    // Folds in a profiler (same options) that was fed the records right after
+    // this one's, e.g. the next row range of a parallel run. The result is the
+    // profile of the concatenated stream: counts and types exactly, sketches
+    // within their usual bounds. A column one side never had gets that side's
+    // rows as empty cells, as the sequential padding of short rows would.
+    void merge(column_profiler& o){
+        flush();
+        o.flush();
+        scratch_peak_ += o.scratch_peak_;   // the profilers' arenas coexisted
+        kernel_spans_.merge(o.kernel_spans_);
+        if (!o.header_read_) return;
+        if (project_ && o.keep_.size() > keep_.size()){
+            // the right side met wider rows: take its mask for the new fields
+            keep_.insert(keep_.end(), o.keep_.begin() + static_cast<std::ptrdiff_t>(keep_.size()), o.keep_.end());
+            tok_.set_projection(keep_, include_.empty());
+        }
+        if (!header_read_){
+            header_read_ = true;
+            names_ = o.names_;
+            states_ = std::move(o.states_);
+            rows_ = o.rows_;
+            batch_.set_width(states_.size());
+            return;
+        }
+        const std::size_t left = states_.size();
+        for (std::size_t c=0; c<left; ++c){
+            if (c >= o.states_.size()){ pad_empty(states_[c], o.rows_); continue; }
+            pad_empty(states_[c], o.states_[c].first_row);
+            states_[c].merge(o.states_[c]);
+        }
+        for (std::size_t c=left; c<o.states_.size(); ++c){
+            states_.push_back(std::move(o.states_[c]));
+            states_.back().first_row += rows_;
+            names_.push_back(c < o.names_.size() ? o.names_[c] : "col" + std::to_string(c+1));
+        }
+        rows_ += o.rows_;
+        batch_.set_width(states_.size());
+    }
+
+    // Accumulated state (layout, row count, every column's counts, candidates
+    // and sketches) as bytes, and back: a loaded profiler finishes, merges and
+    // takes further records exactly as the saved one would have. The options
+    // are not part of the state; load() expects a profiler built with the
+    // same ones (callers key saved state by them).
+    void save(byte_writer& w){
+        flush();
+        w.put(header_read_);
+        w.put(rows_);
+        w.put<std::uint64_t>(names_.size());
+        for (const auto& n : names_) w.put_str(n);
+        w.put_vec(keep_);
+        w.put<std::uint64_t>(states_.size());
+        for (const auto& st : states_) st.save(w);
+    }
+    void load(byte_reader& r){
+        header_read_ = r.get<bool>();
+        rows_ = r.get<std::uint64_t>();
+        names_.resize(static_cast<std::size_t>(r.get<std::uint64_t>()));
+        for (auto& n : names_) n = r.get_str();
+        keep_ = r.get_vec<std::uint8_t>();
+        states_.clear();
+        grow_states(static_cast<std::size_t>(r.get<std::uint64_t>()), 0);
+        for (auto& st : states_) st.load(r);
+        if (project_ && header_read_) tok_.set_projection(keep_, include_.empty());
+        batch_.set_width(states_.size());
+    }
+
+    ProfileResult finish(){
+        flush();
+        ProfileResult pr{};
+        pr.rows = rows_;
+        pr.scratch_arena_bytes = scratch_peak_;
+        pr.columns.resize(states_.size());
+        for (size_t i=0;i<states_.size(); ++i){
+            auto& cs = pr.columns[i];
+            const auto& st = states_[i];
+            pr.memo_lookups += st.memo.lookups();
+            pr.memo_hits    += st.memo.hits();
+            if (st.track_topk){
+                pr.key_arena_bytes += st.cat.top.key_bytes_reserved();
+                pr.interned_keys   += st.cat.top.interned_keys();
+            }
+            cs.name = (i < names_.size() && !names_[i].empty()) ? names_[i] : ("col"+std::to_string(i+1));
+            cs.null_count = st.nulls;
+            cs.non_null_count = st.non_nulls;
+
+            // narrowest remaining candidate, by “all values are X” priority
+            if (cs.non_null_count == 0 && !st.forced) cs.logical_type = "string";
+            else if (st.can(type_bits::boolean))  cs.logical_type = "bool";
+            else if (st.can(type_bits::int64))    cs.logical_type = "int";
+            else if (st.can(type_bits::float64))  cs.logical_type = "float";
+            else if (st.can(type_bits::date))     cs.logical_type = "date";
+            else if (st.can(type_bits::datetime)) cs.logical_type = "datetime";
+            else                                  cs.logical_type = "string";
+
+            if ((cs.logical_type == "int" || cs.logical_type == "float") && st.num.non_null_count > 0){
+                cs.min    = st.num.min;
+                cs.max    = st.num.max;
+                cs.mean   = st.num.mean;
+                cs.stddev = st.num.stddev();
+                std::vector<double> qs = quantiles_;
+                qs.push_back(0.5);
+                const std::vector<double> vals = st.num.quantiles(qs);
+                cs.median = vals.back();
+                for (size_t q=0;q<quantiles_.size();++q) cs.quantiles.emplace_back(quantiles_[q], vals[q]);
+                if (cs.logical_type == "int"){ cs.min_int = st.imin; cs.max_int = st.imax; }
+                if (st.num.hist.count() > 0)   // integer columns: bins at least 1 wide
+                    cs.hist = st.num.hist.to_histogram(cs.logical_type == "int" ? 0 : std::numeric_limits<int>::min());
+            }
+            cs.cardinality = st.distinct.estimate();
+            if (st.track_topk && cs.non_null_count > 0){
+                for (const auto& e : st.cat.top.top(topk_))
+                    cs.topk.push_back({std::string(e.key), e.count, e.error});
+            }
+            if ((cs.logical_type == "date" || cs.logical_type == "datetime") && st.dates > 0){
+                const bool with_time = cs.logical_type == "datetime";
+                cs.min_text = format_date_value(st.tmin, with_time);
+                cs.max_text = format_date_value(st.tmax, with_time);
+            }
+        }
+        return pr;
+    }
+
+private:
+    static std::vector<std::string> synth_names(std::size_t from, std::size_t to){
+        std::vector<std::string> out;
+        for (std::size_t i=from;i<to;++i) out.push_back("col" + std::to_string(i+1));
+        return out;
+    }
+
+    bool selected(const std::string& name) const {
+        if (!include_.empty() && std::find(include_.begin(), include_.end(), name) == include_.end()) return false;
+        return std::find(exclude_.begin(), exclude_.end(), name) == exclude_.end();
+    }
+
+    // Source column names -> reported columns (and the tokenizer mask).
+    void set_layout(const std::vector<std::string>& all){
+        if (!project_) names_ = all;
+        else {
+            keep_.assign(all.size(), 0);
+            for (std::size_t i=0;i<all.size();++i)
+                if (selected(all[i])){ keep_[i] = 1; names_.push_back(all[i]); }
+            // with an include list nothing past the known columns can be wanted
+            tok_.set_projection(keep_, include_.empty());
+        }
+        grow_states(names_.size(), 0);
+        batch_.set_width(names_.size());
+    }
+
+    // A row wider than every row so far, tokenized with the current mask: all
+    // masked fields are present, so the surplus is the new source columns.
+    // Only reachable without an include list (keep_rest).
+    void widen_projection(std::string_view line){
+        const std::size_t width = keep_.size() + (rec_.size() - states_.size());
+        for (std::string& nm : synth_names(keep_.size(), width)){
+            const bool k = selected(nm);
+            keep_.push_back(k ? 1 : 0);
+            if (k) names_.push_back(std::move(nm));
+        }
+        tok_.set_projection(keep_, true);
+        grow_states(names_.size(), rows_ - 1);
+        batch_.set_width(names_.size());
+        tok_.tokenize(line, rec_, scratch_);
+    }
+
+    void apply_force(column_state& st, const std::string& name) const {
+        for (const auto& [col, type] : forced_){
+            if (col != name) continue;
+            const auto bits = forced_type_bits(type);
+            if (!bits) throw std::invalid_argument("[types] force: unknown type '" + type + "' for column " + name);
+            st.types  = *bits;
+            st.forced = true;
+        }
+    }
+
+    void grow_states(std::size_t n, std::uint64_t rows_before){
+        while (states_.size() < n){
+            states_.emplace_back();
+            auto& st = states_.back();
+            st.first_row = rows_before;
+            st.num = numeric_stats(quantile_k_, hist_bins_);
+            st.distinct = hll_sketch(hll_precision_);
+            if (states_.size() <= names_.size()) apply_force(st, names_[states_.size() - 1]);
+            if (topk_ > 0){
+                st.cat = categorical_stats(std::max(topk_counters_, topk_));
+                st.track_topk = true;
+            }
+        }
+    }
+
+    bool in_source(std::string_view v) const noexcept {
+        if (source_.empty()) return false;
+        const char* b = source_.data();
+        return v.data() >= b && v.data() + v.size() <= b + source_.size();
+    }
+
+    void run_kernels(){
+        if (batch_.empty()) return;
+        WallTimer t;
+        t.start();
+        const std::size_t n = batch_.rows();
+        for (size_t c=0;c<states_.size();++c)
+            profile_column_cells(states_[c], batch_.column(c), n, nulls_, dates_, vals_);
+        batch_.clear();
+        t.stop();
+        kernel_spans_.add(t);
+    }
+
+    void flush(){
+        run_kernels();
+        scratch_peak_ = std::max(scratch_peak_, scratch_.bytes_reserved());
+        scratch_.reset();
+    }
+
+    // Profiles n missing (empty) cells of one column.
+    void pad_empty(column_state& st, std::uint64_t n){
+        static const std::array<std::string_view, 256> empty{};
+        while (n > 0){
+            const std::size_t k = static_cast<std::size_t>(std::min<std::uint64_t>(n, empty.size()));
+            profile_column_cells(st, empty.data(), k, nulls_, dates_, vals_);
+            n -= k;
+        }
+    }
+
+    char delim_;
+    char quote_;
+    bool header_present_;
+    null_matcher             nulls_;
+    date_parser              dates_;
+    std::vector<double>      quantiles_;
+    std::uint16_t            quantile_k_;
+    int                      hist_bins_;
+    std::size_t              topk_;
+    std::size_t              topk_counters_;
+    unsigned                 hll_precision_;
+    std::vector<std::string> include_, exclude_;
+    std::vector<std::pair<std::string, std::string>> forced_;
+    bool                     project_;
+    std::vector<std::uint8_t> keep_;   // source field -> selected (project_ only)
+
+    bool header_read_ = false;
+    std::uint64_t rows_ = 0;
+    std::vector<std::string> names_;
+    std::vector<column_state> states_;
+
+    record_tokenizer tok_{delim_, quote_};
+    record_view      rec_;
+    arena            scratch_;
+    std::size_t      scratch_peak_ = 0;
+    span_histogram   kernel_spans_;
+    column_batch     batch_;
+    std::vector<std::string_view> vals_;
+    std::string_view source_;
+};
+
+// Standalone pass over a file (the main pipeline uses fused_scan instead).
+inline ProfileResult profile_csv_file(const std::string& path,
+                                      char delim,
+                                      char quote,
+                                      bool header_present,
+                                      const profile_options& popt = {},
+                                      std::size_t chunk_bytes = 1u << 20)
+{
+    {
+        std::ifstream probe(path, std::ios::binary);
+        if (!probe) return {};
+    }
+
+    column_profiler prof(delim, quote, header_present, popt);
+    record_splitter split(quote);
+    auto on_record = [&](std::string_view rec){ prof.add_record(rec); };
+
+    chunk_reader reader(path, chunk_bytes);
+    for (std::string_view w = reader.next(); !w.empty(); w = reader.next()) {
+        prof.begin_chunk(w);
+        split.feed(w, on_record);
+        prof.end_batch();
+    }
+    split.finish(on_record);
+    return prof.finish();
 }
 
 }
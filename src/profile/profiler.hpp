@@ -3,19 +3,33 @@
 #include <cstdint>
 #include <optional>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 #include <vector>
 #include <algorithm>
 #include <cmath>
 
+#include "histogram.hpp"
+#include "hll.hpp"
+#include "kll.hpp"
+#include "topk.hpp"
+#include "../util/serial.hpp"
+
 namespace csvqr {
 
+// Moments are exact (Welford); quantiles come from a KLL sketch and the
+// histogram is a streaming one, so memory stays constant per column (see
+// kll.hpp for the error bound; histogram counts are exact).
 struct numeric_stats {
     std::size_t null_count{0};
     std::size_t non_null_count{0};
     double min{0.0}, max{0.0};
     double mean{0.0}, m2{0.0}; // Welford
-    std::vector<double> sample; // for median/quantiles
+    kll_sketch sketch;          // for median/quantiles
+    stream_histogram hist;
+
+    numeric_stats() = default;
+    explicit numeric_stats(std::uint16_t quantile_k, int hist_bins = 32) : sketch(quantile_k), hist(hist_bins) {}
+
     void add_null() { ++null_count; }
     void add(double x) {
         ++non_null_count;
@@ -27,28 +41,81 @@ struct numeric_stats {
             mean += delta / static_cast<double>(non_null_count);
             m2 += delta * (x - mean);
         }
-        sample.push_back(x);
+        sketch.add(x);
+        hist.add(x);
     }
-    double variance() const { return non_null_count > 1 ? m2 / (non_null_count - 1) : 0.0; }
-    double stddev() const { return std::sqrt(variance()); }
-    double quantile(double q) {
-        if (sample.empty()) return 0.0;
-        auto v = sample;
-        std::sort(v.begin(), v.end());
-        double pos = q * (v.size() - 1);
-        std::size_t i = static_cast<std::size_t>(pos);
-        double frac = pos - static_cast<double>(i);
-        if (i + 1 < v.size()) return v[i] * (1.0 - frac) + v[i + 1] * frac;
-        return v[i];
+    // Chan et al.'s pairwise update: moments as if both streams were added here.
+    void merge(const numeric_stats& o) {
+        null_count += o.null_count;
+        if (o.non_null_count > 0) {
+            if (non_null_count == 0) { min = o.min; max = o.max; mean = o.mean; m2 = o.m2; }
+            else {
+                const double n1 = static_cast<double>(non_null_count);
+                const double n2 = static_cast<double>(o.non_null_count);
+                const double delta = o.mean - mean;
+                min = std::min(min, o.min);
+                max = std::max(max, o.max);
+                mean += delta * n2 / (n1 + n2);
+                m2 += o.m2 + delta * delta * n1 * n2 / (n1 + n2);
+            }
+            non_null_count += o.non_null_count;
+        }
+        sketch.merge(o.sketch);
+        hist.merge(o.hist);
+    }
+    void save(byte_writer& w) const {
+        w.put<std::uint64_t>(null_count);
+        w.put<std::uint64_t>(non_null_count);
+        w.put(min); w.put(max); w.put(mean); w.put(m2);
+        sketch.save(w);
+        hist.save(w);
     }
+    void load(byte_reader& r) {
+        null_count     = static_cast<std::size_t>(r.get<std::uint64_t>());
+        non_null_count = static_cast<std::size_t>(r.get<std::uint64_t>());
+        min = r.get<double>(); max = r.get<double>(); mean = r.get<double>(); m2 = r.get<double>();
+        sketch.load(r);
+        hist.load(r);
+    }
+    double variance() const { return non_null_count > 1 ? m2 / static_cast<double>(non_null_count - 1) : 0.0; }
+    double stddev() const { return std::sqrt(variance()); }
+    double quantile(double q) const { return sketch.quantile(q); }
+    std::vector<double> quantiles(const std::vector<double>& qs) const { return sketch.quantiles(qs); }
 };
 
+// Frequent values in fixed memory: Space-Saving counters (see topk.hpp for
+// the count/error guarantee) instead of a map of every distinct value.
 struct categorical_stats {
     std::size_t null_count{0};
     std::size_t non_null_count{0};
-    std::unordered_map<std::string, std::size_t> freq;
+    space_saving top;
+
+    categorical_stats() = default;
+    explicit categorical_stats(std::size_t counters) : top(counters) {}
+
     void add_null() { ++null_count; }
-    void add(const std::string& s) { ++non_null_count; ++freq[s]; }
+    void add(std::string_view s) { ++non_null_count; top.add(s); }
+    void add(std::string_view s, std::uint64_t hash) { ++non_null_count; top.add(s, hash, 1); }
+    void add(std::string_view s, std::uint64_t hash, std::uint64_t times) { non_null_count += times; top.add(s, hash, times); }
+    std::size_t add_hinted(std::string_view s, std::uint64_t hash, std::size_t hint) {
+        ++non_null_count;
+        return top.add_hinted(s, hash, hint);
+    }
+    void merge(const categorical_stats& o) {
+        null_count += o.null_count;
+        non_null_count += o.non_null_count;
+        top.merge(o.top);
+    }
+    void save(byte_writer& w) const {
+        w.put<std::uint64_t>(null_count);
+        w.put<std::uint64_t>(non_null_count);
+        top.save(w);
+    }
+    void load(byte_reader& r) {
+        null_count     = static_cast<std::size_t>(r.get<std::uint64_t>());
+        non_null_count = static_cast<std::size_t>(r.get<std::uint64_t>());
+        top.load(r);
+    }
 };
 
 }
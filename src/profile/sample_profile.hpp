@@ -0,0 +1,221 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <string_view>
+#include <vector>
+
+#include "../csv/parallel_count.hpp"
+#include "../csv/record_view.hpp"
+#include "../csv/tokenizer.hpp"
+#include "../util/arena.hpp"
+#include "profile.hpp"
+
+namespace csvqr {
+
+struct sample_options {
+    double        fraction    = 0.10;        // share of the data bytes to profile, in (0, 1)
+    std::uint64_t max_rows    = 200000;      // stop once this many rows are profiled; 0 = no cap
+    std::size_t   block_bytes = 256 * 1024;  // contiguous bytes profiled per random offset
+    std::uint64_t seed        = 0x5eed;      // fixed, so a report is reproducible
+};
+
+struct sampled_profile_result {
+    ProfileResult profile;          // counts extrapolated to the whole input; profile.sample set
+    std::uint64_t records = 0;      // records profiled, header included
+    std::uint64_t bytes   = 0;      // bytes those records span
+};
+
+namespace detail {
+
+// Terminator of the record starting at p (outside quotes), or data.size().
+inline std::size_t record_end(std::string_view data, std::size_t p, char quote) noexcept {
+    bool inq = false;
+    for (; p < data.size(); ++p) {
+        const char c = data[p];
+        if (c == quote) inq = !inq;
+        else if (!inq && (c == '\n' || c == '\r')) return p;
+    }
+    return p;
+}
+
+inline std::size_t after_terminator(std::string_view data, std::size_t e) noexcept {
+    if (e >= data.size()) return e;
+    return (data[e] == '\r' && e + 1 < data.size() && data[e + 1] == '\n') ? e + 2 : e + 1;
+}
+
+// First record start at or after pos, resolving the unknown quote state at
+// pos: both states are tried and the one whose next few records have the
+// expected width wins (ties go to "outside quotes", the common case). nullopt
+// if neither yields a majority of well-formed records before `limit`.
+inline std::optional<std::size_t> resync(std::string_view data, std::size_t pos, std::size_t limit,
+                                         char delim, char quote, std::size_t width) {
+    constexpr int probe = 8;
+    record_tokenizer tok(delim, quote);
+    record_view view;
+    arena scratch(4096);
+    std::optional<std::size_t> best;
+    int best_match = 0;
+    for (bool in_quotes : {false, true}) {
+        // bounded: a wrong "inside quotes" guess would otherwise run to EOF
+        std::size_t r = next_record_start(data.substr(0, limit), pos, in_quotes, quote);
+        if (r > 0 && r < data.size() && data[r - 1] == '\r' && data[r] == '\n') ++r;   // landed inside a CRLF
+        if (r >= limit) continue;
+        int seen = 0, match = 0;
+        for (std::size_t p = r; seen < probe && p < data.size(); ++seen) {
+            const std::size_t e = record_end(data, p, quote);
+            tok.tokenize(data.substr(p, e - p), view, scratch);
+            if (view.size() == width) ++match;
+            p = after_terminator(data, e);
+        }
+        scratch.reset();
+        if (match * 2 > seen && match > best_match) { best = r; best_match = match; }
+    }
+    return best;
+}
+
+// 95% interval of a ratio estimate scaled to `total` bytes, from per-block
+// (count, bytes) pairs: the usual cluster-sampling variance of a ratio
+// estimator with a finite-population correction.
+inline std::pair<double, double> ratio_interval(const std::vector<double>& counts,
+                                                const std::vector<double>& bytes,
+                                                double total) {
+    double sc = 0.0, sb = 0.0;
+    for (std::size_t i = 0; i < counts.size(); ++i) { sc += counts[i]; sb += bytes[i]; }
+    const double r = sb > 0.0 ? sc / sb : 0.0;
+    const double est = r * total;
+    const std::size_t k = counts.size();
+    if (k < 2 || sb <= 0.0) return {est, est};
+    double ss = 0.0;
+    for (std::size_t i = 0; i < k; ++i) {
+        const double d = counts[i] - r * bytes[i];
+        ss += d * d;
+    }
+    const double mean_b = sb / static_cast<double>(k);
+    const double fpc = std::max(0.0, 1.0 - sb / total);
+    const double var = fpc * ss / static_cast<double>(k - 1) / (static_cast<double>(k) * mean_b * mean_b);
+    const double half = 1.96 * std::sqrt(var) * total;
+    return {est - half, est + half};
+}
+
+} // namespace detail
+
+// Approximate profile of an in-memory buffer (typically a mapped file) from
+// randomly placed blocks. The data after the header is cut into one stratum
+// per block of the byte budget (fraction * size); each block starts at a
+// random offset in its stratum, resynchronizes to a record boundary and
+// profiles the records that start inside it. Blocks are visited in random
+// order until the budget or max_rows is reached. Row and null counts are
+// extrapolated by bytes, with 95% intervals; types, bounds, quantiles, top-k
+// and distinct counts describe the sampled rows.
+//
+// Returns nullopt when sampling would not save work (small input, a
+// fraction of 0 or >= 1) or no block could be resynchronized; the caller
+// then profiles the whole input.
+inline std::optional<sampled_profile_result> profile_sampled(std::string_view data,
+                                                             char delim,
+                                                             char quote,
+                                                             bool header_present,
+                                                             const profile_options& popt,
+                                                             const sample_options& so) {
+    const std::size_t n = data.size();
+    const std::size_t b = std::max<std::size_t>(so.block_bytes, 4096);
+    if (!(so.fraction > 0.0 && so.fraction < 1.0) || n == 0) return std::nullopt;
+
+    const std::size_t e0 = detail::record_end(data, 0, quote);
+    const std::string_view first = data.substr(0, e0);
+    const std::size_t begin = header_present ? detail::after_terminator(data, e0) : 0;
+    if (begin >= n) return std::nullopt;
+    const std::size_t body = n - begin;
+    const auto k = static_cast<std::size_t>(std::ceil(so.fraction * static_cast<double>(body) / static_cast<double>(b)));
+    if (body < 4 * b || k * b * 2 > body) return std::nullopt;
+
+    record_tokenizer tok(delim, quote);
+    record_view view;
+    arena scratch(4096);
+    tok.tokenize(first, view, scratch);
+    const std::size_t width = view.size();
+
+    column_profiler prof(delim, quote, false, popt);
+    prof.preset_layout(first, header_present);
+    prof.begin_chunk(data);
+
+    const std::size_t stratum = body / k;
+    std::mt19937_64 rng(so.seed);
+    std::vector<std::size_t> offsets(k);
+    for (std::size_t i = 0; i < k; ++i)
+        offsets[i] = begin + i * stratum + (stratum > b ? static_cast<std::size_t>(rng() % (stratum - b)) : 0);
+    std::shuffle(offsets.begin(), offsets.end(), rng);
+
+    sampled_profile_result out;
+    std::vector<double> block_rows, block_bytes;
+    std::vector<std::vector<double>> block_nulls;   // [block][column]
+    std::vector<std::uint64_t> nulls_before;
+    for (std::size_t pos : offsets) {
+        if (so.max_rows && prof.rows() >= so.max_rows) break;
+        const std::size_t block_end = std::min(pos + b, n);
+        const auto start = detail::resync(data, pos, block_end, delim, quote, width);
+        if (!start) continue;
+        const std::uint64_t rows0 = prof.rows();
+        std::size_t p = *start;
+        while (p < block_end) {
+            const std::size_t e = detail::record_end(data, p, quote);
+            prof.add_record(data.substr(p, e - p));
+            p = detail::after_terminator(data, e);
+            if (so.max_rows && prof.rows() >= so.max_rows) break;
+        }
+        prof.end_batch();
+        prof.begin_chunk(data);
+
+        const std::vector<std::uint64_t> nulls = prof.null_counts();
+        nulls_before.resize(nulls.size(), 0);
+        std::vector<double> delta(nulls.size());
+        for (std::size_t c = 0; c < nulls.size(); ++c) delta[c] = static_cast<double>(nulls[c] - nulls_before[c]);
+        nulls_before = nulls;
+        block_rows.push_back(static_cast<double>(prof.rows() - rows0));
+        block_bytes.push_back(static_cast<double>(p - *start));
+        block_nulls.push_back(std::move(delta));
+        out.bytes += p - *start;
+    }
+    if (block_rows.empty()) return std::nullopt;
+
+    ProfileResult pr = prof.finish();
+    const double total = static_cast<double>(body);
+    const std::uint64_t seen = pr.rows;
+    const auto [rows_lo, rows_hi] = detail::ratio_interval(block_rows, block_bytes, total);
+    double sb = 0.0;
+    for (double x : block_bytes) sb += x;
+    const double est_rows = static_cast<double>(seen) / sb * total;
+
+    auto clamp_count = [](double x, std::uint64_t lo, std::uint64_t hi) {
+        const auto v = static_cast<std::uint64_t>(std::llround(std::max(0.0, x)));
+        return std::clamp(v, lo, std::max(lo, hi));
+    };
+    sample_info info;
+    info.blocks   = block_rows.size();
+    info.rows     = seen;
+    info.fraction = sb / total;
+    info.rows_lo  = clamp_count(rows_lo, seen, ~std::uint64_t{0});
+    info.rows_hi  = clamp_count(rows_hi, info.rows_lo, ~std::uint64_t{0});
+    pr.rows = clamp_count(est_rows, info.rows_lo, info.rows_hi);
+
+    std::vector<double> col(block_rows.size());
+    for (std::size_t c = 0; c < pr.columns.size(); ++c) {
+        auto& cs = pr.columns[c];
+        for (std::size_t i = 0; i < col.size(); ++i) col[i] = c < block_nulls[i].size() ? block_nulls[i][c] : 0.0;
+        const auto [lo, hi] = detail::ratio_interval(col, block_bytes, total);
+        const std::uint64_t nulls_seen = cs.null_count;
+        const std::uint64_t est = clamp_count(static_cast<double>(nulls_seen) / sb * total, nulls_seen, pr.rows);
+        cs.null_count_ci = std::make_pair(clamp_count(lo, nulls_seen, est), clamp_count(hi, est, info.rows_hi));
+        cs.null_count = est;
+        cs.non_null_count = pr.rows - est;
+    }
+    pr.sample = info;
+    out.profile = std::move(pr);
+    out.records = seen + (header_present ? 1 : 0);
+    return out;
+}
+
+}
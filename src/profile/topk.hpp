@@ -0,0 +1,411 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "../util/arena.hpp"
+#include "../util/hash.hpp"
+#include "../util/intern.hpp"
+#include "../util/serial.hpp"
+
+namespace csvqr {
+
+// Space-Saving heavy hitters (Metwally et al. 2005) over string_views.
+// Keeps `capacity` counters; an unseen value takes over the smallest counter
+// and inherits its count as its error. Guarantees, for n values added:
+//  - every value with true count > n / capacity is tracked
+//  - a tracked value's true count is in [count - error, count]
+// Memory is fixed: counters + an open-addressing index over their hashes +
+// an interning pool holding the admitted keys (rebuilt when evicted keys pile
+// up). Keys are only copied the first time they are admitted, so repeats of
+// a tracked value are a hash and a probe, and a value that is evicted and
+// comes back reuses its bytes. Counters sit in the paper's Stream-Summary (a list of
+// count buckets in increasing order), so +1 updates and evictions are O(1).
+// Admission is filtered (Homem & Carvalho 2010): once full, an unseen value
+// bumps a small hashed counter and only takes over the smallest slot when that
+// counter reaches it, so ID-like columns rarely evict or copy keys. The filter
+// counter is an upper bound on the value's unseen occurrences and becomes its
+// error, which keeps the guarantees above.
+class space_saving {
+public:
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    struct entry {
+        std::string_view key;
+        std::uint64_t    hash  = 0;
+        std::uint64_t    count = 0;
+        std::uint64_t    error = 0;
+    };
+
+    explicit space_saving(std::size_t capacity = 80)
+        : cap_(capacity < 2 ? 2 : capacity), keys_(4096)
+    {
+        std::size_t slots = 4;
+        while (slots < cap_ * 2) slots <<= 1;
+        index_.assign(slots, empty_slot);
+        filter_.assign(slots * 4, 0);
+        entries_.reserve(cap_);
+        links_.reserve(cap_);
+        buckets_.reserve(cap_);
+    }
+
+    space_saving(const space_saving& o) : space_saving(o.cap_) { merge(o); }
+    space_saving& operator=(const space_saving& o) {
+        if (this != &o) { space_saving t(o); swap(t); }
+        return *this;
+    }
+    space_saving(space_saving&&) noexcept = default;
+    space_saving& operator=(space_saving&&) noexcept = default;
+
+    void add(std::string_view v, std::uint64_t times = 1) { add(v, hash64(v), times); }
+
+    // Returns the entry now counting v, or npos if only its filter cell moved.
+    std::size_t add(std::string_view v, std::uint64_t h, std::uint64_t times) {
+        n_ += times;
+        const std::size_t slot = find(v, h);
+        if (index_[slot] != empty_slot) {
+            bump(index_[slot], times);
+            return index_[slot];
+        }
+        if (entries_.size() < cap_) {
+            const auto e = static_cast<std::uint32_t>(entries_.size());
+            entries_.push_back(entry{admit(v, h), h, times, 0});
+            links_.emplace_back();
+            index_[slot] = e;
+            insert_sorted(e);
+            return e;
+        }
+        std::uint64_t& alpha = filter_[filter_slot(h)];
+        const std::uint64_t floor = min_count();
+        if (alpha + times < floor) { alpha += times; return npos; }
+
+        // take over one of the smallest counters; its count moves to the filter
+        const std::uint32_t e = buckets_[min_bucket_].head;
+        entry& victim = entries_[e];
+        std::uint64_t& victim_alpha = filter_[filter_slot(victim.hash)];
+        victim_alpha = std::max(victim_alpha, floor);
+        erase_index(victim.key, victim.hash);
+        live_bytes_ -= victim.key.size();
+        const std::uint64_t seen = alpha;   // read after the victim's fold-in (same cell possible)
+        victim.key   = admit(v, h);
+        victim.hash  = h;
+        victim.error = seen;
+        index_[find(v, h)] = e;
+        bump(e, seen + times - floor);
+        maybe_compact();
+        return e;
+    }
+
+    // add() of one occurrence with the entry a previous add() of the same
+    // value returned (e.g. remembered by a memoized cell); skips the index
+    // probe while the entry still holds v, and falls back to add() otherwise.
+    std::size_t add_hinted(std::string_view v, std::uint64_t h, std::size_t hint) {
+        if (hint < entries_.size() && entries_[hint].hash == h && entries_[hint].key == v) {
+            ++n_;
+            bump(static_cast<std::uint32_t>(hint), 1);
+            return hint;
+        }
+        return add(v, h, 1);
+    }
+
+    // Combine two summaries (same capacity): counts and filters add, and a
+    // value missing on one side gets that side's untracked bound as extra
+    // error. Associative up to the usual Space-Saving bounds.
+    void merge(const space_saving& o) {
+        if (o.n_ == 0) return;
+        const std::uint64_t my_min = max_untracked_count();
+        const std::uint64_t o_min  = o.max_untracked_count();
+        std::vector<std::uint64_t> filter = filter_;
+        if (filter.size() == o.filter_.size())
+            for (std::size_t i = 0; i < filter.size(); ++i) filter[i] += o.filter_[i];
+        else
+            for (auto& a : filter) a += o_min;
+
+        std::vector<entry> all;
+        all.reserve(entries_.size() + o.entries_.size());
+        for (const auto& e : entries_) {
+            const std::size_t j = o.lookup(e.key, e.hash);
+            entry m = e;
+            if (j != npos) { m.count += o.entries_[j].count; m.error += o.entries_[j].error; }
+            else           { m.count += o_min; m.error += o_min; }
+            all.push_back(m);
+        }
+        for (const auto& e : o.entries_) {
+            if (lookup(e.key, e.hash) != npos) continue;
+            entry m = e;
+            m.count += my_min;
+            m.error += my_min;
+            all.push_back(m);
+        }
+
+        std::sort(all.begin(), all.end(), ranks_before);
+        for (std::size_t i = cap_; i < all.size(); ++i) {
+            std::uint64_t& a = filter[filter_slot(all[i].hash)];
+            a = std::max(a, all[i].count);
+        }
+        if (all.size() > cap_) all.resize(cap_);
+
+        // survivors move to a fresh pool before both sides' keys go away
+        string_interner keys(4096);
+        std::size_t live = 0;
+        for (auto& e : all) { e.key = keys.intern(e.key, e.hash); live += e.key.size(); }
+
+        const std::uint64_t n = n_ + o.n_;
+        clear();
+        n_ = n;
+        filter_.swap(filter);
+        keys_ = std::move(keys);
+        live_bytes_ = live;
+        // smallest first keeps each insert's walk from the bottom short
+        for (auto it = all.rbegin(); it != all.rend(); ++it) {
+            const auto idx = static_cast<std::uint32_t>(entries_.size());
+            entries_.push_back(entry{it->key, it->hash, it->count, it->error});
+            links_.emplace_back();
+            index_[find(it->key, it->hash)] = idx;
+            insert_sorted(idx);
+        }
+    }
+
+    // Report order: biggest count first, then smaller error, then key bytes,
+    // so ties come out the same whatever the slot order (after merge, load).
+    static bool ranks_before(const entry& a, const entry& b) noexcept {
+        if (a.count != b.count) return a.count > b.count;
+        if (a.error != b.error) return a.error < b.error;
+        return a.key < b.key;
+    }
+
+    // The k largest counters in report order (ranks_before).
+    std::vector<entry> top(std::size_t k) const {
+        std::vector<entry> out(entries_.begin(), entries_.end());
+        std::sort(out.begin(), out.end(), ranks_before);
+        if (out.size() > k) out.resize(k);
+        return out;
+    }
+
+    std::uint64_t total()    const noexcept { return n_; }
+    std::size_t   capacity() const noexcept { return cap_; }
+    std::size_t   size()     const noexcept { return entries_.size(); }
+    // Largest possible count of a value that is not tracked.
+    std::uint64_t max_untracked_count() const noexcept {
+        std::uint64_t m = entries_.size() < cap_ ? 0 : min_count();
+        for (std::uint64_t a : filter_) m = std::max(m, a);
+        return m;
+    }
+    std::size_t   key_bytes_reserved() const noexcept { return keys_.bytes_reserved(); }
+    std::size_t   interned_keys()      const noexcept { return keys_.size(); }
+
+    // Counters, keys and filter; the Stream-Summary and the index are rebuilt
+    // on load, so a loaded summary reports and continues as the saved one.
+    void save(byte_writer& w) const {
+        w.put<std::uint64_t>(cap_);
+        w.put(n_);
+        w.put<std::uint64_t>(entries_.size());
+        for (const auto& e : entries_) {
+            w.put_str(e.key);
+            w.put(e.count);
+            w.put(e.error);
+        }
+        w.put_vec(filter_);
+    }
+    void load(byte_reader& r) {
+        space_saving t(static_cast<std::size_t>(r.get<std::uint64_t>()));
+        t.n_ = r.get<std::uint64_t>();
+        const auto n = r.get<std::uint64_t>();
+        if (n > t.cap_) throw std::runtime_error("space_saving: more entries than counters");
+        for (std::uint64_t i = 0; i < n; ++i) {
+            const std::string key = r.get_str();
+            const std::uint64_t h = hash64(key);
+            const auto count = r.get<std::uint64_t>();
+            const auto error = r.get<std::uint64_t>();
+            if (t.lookup(key, h) != npos) throw std::runtime_error("space_saving: duplicate key");
+            const auto idx = static_cast<std::uint32_t>(t.entries_.size());
+            t.entries_.push_back(entry{t.admit(key, h), h, count, error});
+            t.links_.emplace_back();
+            t.index_[t.find(key, h)] = idx;
+            t.insert_sorted(idx);
+        }
+        std::vector<std::uint64_t> filter = r.get_vec<std::uint64_t>();
+        if (filter.size() != t.filter_.size()) throw std::runtime_error("space_saving: filter size mismatch");
+        t.filter_.swap(filter);
+        swap(t);
+    }
+
+    void clear() {
+        entries_.clear();
+        links_.clear();
+        buckets_.clear();
+        free_buckets_.clear();
+        min_bucket_ = nil;
+        std::fill(index_.begin(), index_.end(), empty_slot);
+        std::fill(filter_.begin(), filter_.end(), 0);
+        keys_.clear();
+        live_bytes_ = 0;
+        n_ = 0;
+    }
+
+    void swap(space_saving& o) noexcept {
+        std::swap(cap_, o.cap_);
+        std::swap(n_, o.n_);
+        entries_.swap(o.entries_);
+        links_.swap(o.links_);
+        buckets_.swap(o.buckets_);
+        free_buckets_.swap(o.free_buckets_);
+        std::swap(min_bucket_, o.min_bucket_);
+        index_.swap(o.index_);
+        filter_.swap(o.filter_);
+        std::swap(keys_, o.keys_);
+        std::swap(live_bytes_, o.live_bytes_);
+    }
+
+private:
+    static constexpr std::uint32_t empty_slot = 0xffffffffu;
+    static constexpr std::uint32_t nil        = 0xffffffffu;
+
+    std::uint64_t min_count() const noexcept { return min_bucket_ == nil ? 0 : buckets_[min_bucket_].count; }
+
+    std::string_view admit(std::string_view v, std::uint64_t h) {
+        const std::string_view k = keys_.intern(v, h);
+        live_bytes_ += k.size();
+        return k;
+    }
+
+    // High hash bits, so filter cells do not line up with index slots.
+    std::size_t filter_slot(std::uint64_t h) const noexcept {
+        return static_cast<std::size_t>(h >> 40) & (filter_.size() - 1);
+    }
+
+    // Slot holding v, or the empty slot where it would go (linear probing).
+    std::size_t find(std::string_view v, std::uint64_t h) const noexcept {
+        const std::size_t mask = index_.size() - 1;
+        for (std::size_t i = static_cast<std::size_t>(h) & mask;; i = (i + 1) & mask) {
+            const std::uint32_t e = index_[i];
+            if (e == empty_slot) return i;
+            if (entries_[e].hash == h && entries_[e].key == v) return i;
+        }
+    }
+
+    std::size_t lookup(std::string_view v, std::uint64_t h) const noexcept {
+        const std::uint32_t e = index_[find(v, h)];
+        return e == empty_slot ? npos : e;
+    }
+
+    // Backward-shift deletion keeps probe chains intact without tombstones.
+    void erase_index(std::string_view v, std::uint64_t h) noexcept {
+        const std::size_t mask = index_.size() - 1;
+        std::size_t i = find(v, h);
+        if (index_[i] == empty_slot) return;
+        for (std::size_t j = (i + 1) & mask;; j = (j + 1) & mask) {
+            const std::uint32_t e = index_[j];
+            if (e == empty_slot) break;
+            const std::size_t home = static_cast<std::size_t>(entries_[e].hash) & mask;
+            // move e back into the hole at i unless its home lies in (i, j]
+            if (((j - home) & mask) >= ((j - i) & mask)) {
+                index_[i] = e;
+                i = j;
+            }
+        }
+        index_[i] = empty_slot;
+    }
+
+    // Evicted keys stay in the pool (ready to be reused) until it is rebuilt
+    // with the live ones: when their bytes or their count (the pool's hash
+    // table) dwarf the live keys.
+    void maybe_compact() {
+        const std::size_t dead = keys_.bytes_used() - live_bytes_;
+        const std::size_t dead_keys = keys_.size() - entries_.size();
+        const bool bytes_heavy = dead >= 64 * 1024 && dead >= 4 * live_bytes_;
+        const bool keys_heavy  = dead_keys >= std::max<std::size_t>(1024, 4 * cap_);
+        if (!bytes_heavy && !keys_heavy) return;
+        string_interner fresh(4096);
+        for (auto& e : entries_) e.key = fresh.intern(e.key, e.hash);
+        std::swap(keys_, fresh);
+    }
+
+    // ---------- Stream-Summary ----------
+    // Buckets form a list in increasing count order; each holds a list of the
+    // entries with exactly that count.
+    struct bucket { std::uint64_t count = 0; std::uint32_t head = nil, prev = nil, next = nil; };
+    struct link   { std::uint32_t bucket = nil, prev = nil, next = nil; };
+
+    std::uint32_t new_bucket(std::uint64_t count, std::uint32_t prev, std::uint32_t next) {
+        std::uint32_t b;
+        if (!free_buckets_.empty()) { b = free_buckets_.back(); free_buckets_.pop_back(); }
+        else { b = static_cast<std::uint32_t>(buckets_.size()); buckets_.emplace_back(); }
+        buckets_[b] = bucket{count, nil, prev, next};
+        if (prev != nil) buckets_[prev].next = b; else min_bucket_ = b;
+        if (next != nil) buckets_[next].prev = b;
+        return b;
+    }
+
+    void attach(std::uint32_t e, std::uint32_t b) noexcept {
+        link& l = links_[e];
+        l.bucket = b;
+        l.prev = nil;
+        l.next = buckets_[b].head;
+        if (l.next != nil) links_[l.next].prev = e;
+        buckets_[b].head = e;
+    }
+
+    void detach(std::uint32_t e) {
+        link& l = links_[e];
+        const std::uint32_t b = l.bucket;
+        if (l.prev != nil) links_[l.prev].next = l.next; else buckets_[b].head = l.next;
+        if (l.next != nil) links_[l.next].prev = l.prev;
+        if (buckets_[b].head == nil) {   // bucket emptied: unlink and recycle
+            const bucket& bk = buckets_[b];
+            if (bk.prev != nil) buckets_[bk.prev].next = bk.next; else min_bucket_ = bk.next;
+            if (bk.next != nil) buckets_[bk.next].prev = bk.prev;
+            free_buckets_.push_back(b);
+        }
+    }
+
+    // Last bucket with count <= c, walking up from `from` (nil = before the first).
+    std::uint32_t last_at_most(std::uint32_t from, std::uint64_t c) const noexcept {
+        std::uint32_t b = from;
+        if (b == nil) { if (min_bucket_ == nil || buckets_[min_bucket_].count > c) return nil; b = min_bucket_; }
+        while (buckets_[b].next != nil && buckets_[buckets_[b].next].count <= c) b = buckets_[b].next;
+        return b;
+    }
+
+    void place(std::uint32_t e, std::uint32_t after) {
+        const std::uint64_t c = entries_[e].count;
+        if (after != nil && buckets_[after].count == c) { attach(e, after); return; }
+        const std::uint32_t next = after == nil ? min_bucket_ : buckets_[after].next;
+        attach(e, new_bucket(c, after, next));
+    }
+
+    void insert_sorted(std::uint32_t e) { place(e, last_at_most(nil, entries_[e].count)); }
+
+    // count += times; with times == 1 this is a hop to the neighbouring bucket.
+    void bump(std::uint32_t e, std::uint64_t times) {
+        const std::uint32_t old = links_[e].bucket;
+        entries_[e].count += times;
+        const std::uint32_t after = last_at_most(old, entries_[e].count);
+        if (after == old && buckets_[old].head == e && links_[e].next == nil) {
+            buckets_[old].count = entries_[e].count;   // sole entry: retag the bucket in place
+            return;
+        }
+        // `after` lies past `old` or `old` keeps other entries, so it survives the detach
+        detach(e);
+        place(e, after);
+    }
+
+    std::size_t                cap_;
+    std::uint64_t              n_ = 0;
+    std::vector<entry>         entries_;
+    std::vector<link>          links_;   // entry index -> bucket membership
+    std::vector<bucket>        buckets_;
+    std::vector<std::uint32_t> free_buckets_;
+    std::uint32_t              min_bucket_ = nil;
+    std::vector<std::uint32_t> index_;   // hash slot -> entry index
+    std::vector<std::uint64_t> filter_;  // unseen-occurrence bounds by hash
+    string_interner            keys_;
+    std::size_t                live_bytes_ = 0;   // key bytes of current entries
+};
+
+}
@@ -1,26 +1,37 @@
 #pragma once
+#include <fmt/format.h>
 #include <fstream>
 #include <string>
+#include <vector>
 
-// Minimal DAG that matches the planned stages.
-inline void emit_dag_json(const std::string& out_path) {
+#include "emit_run_json.hpp"
+
+// Minimal DAG that matches the planned stages. A node's duration_ms is the
+// total_ms of the run stage with the same name, 0.0 if there is none.
+inline void emit_dag_json(const std::string& out_path, const std::vector<RunStage>& stages = {}) {
     std::ofstream f(out_path, std::ios::binary);
     if (!f) return;
 
-    f << R"({
+    auto ms = [&](const char* label) {
+        for (const auto& s : stages)
+            if (s.name == label) return s.total_ms;
+        return 0.0;
+    };
+
+    f << fmt::format(R"({{
   "version":"1",
   "nodes":[
-    {"id":"n1","label":"read_chunks","type":"io","duration_ms":0.0,"rows_in":null,"rows_out":null,"bytes_in":0,"bytes_out":0},
-    {"id":"n2","label":"tokenize_csv","type":"parse","duration_ms":0.0,"rows_in":null,"rows_out":0,"bytes_in":0,"bytes_out":0},
-    {"id":"n3","label":"type_infer","type":"analyze","duration_ms":0.0,"rows_in":0,"rows_out":0,"bytes_in":null,"bytes_out":null},
-    {"id":"n4","label":"profile_columns","type":"profile","duration_ms":0.0,"rows_in":0,"rows_out":0,"bytes_in":null,"bytes_out":null},
-    {"id":"n5","label":"emit_report","type":"render","duration_ms":0.0,"rows_in":null,"rows_out":null,"bytes_in":null,"bytes_out":null}
+    {{"id":"n1","label":"read_chunks","type":"io","duration_ms":{},"rows_in":null,"rows_out":null,"bytes_in":0,"bytes_out":0}},
+    {{"id":"n2","label":"tokenize_csv","type":"parse","duration_ms":{},"rows_in":null,"rows_out":0,"bytes_in":0,"bytes_out":0}},
+    {{"id":"n3","label":"type_infer","type":"analyze","duration_ms":{},"rows_in":0,"rows_out":0,"bytes_in":null,"bytes_out":null}},
+    {{"id":"n4","label":"profile_columns","type":"profile","duration_ms":{},"rows_in":0,"rows_out":0,"bytes_in":null,"bytes_out":null}},
+    {{"id":"n5","label":"emit_report","type":"render","duration_ms":0.0,"rows_in":null,"rows_out":null,"bytes_in":null,"bytes_out":null}}
   ],
   "edges":[
-    {"from":"n1","to":"n2"},
-    {"from":"n2","to":"n3"},
-    {"from":"n3","to":"n4"},
-    {"from":"n4","to":"n5"}
+    {{"from":"n1","to":"n2"}},
+    {{"from":"n2","to":"n3"}},
+    {{"from":"n3","to":"n4"}},
+    {{"from":"n4","to":"n5"}}
   ]
-})";
+}})", ms("read_chunks"), ms("tokenize_csv"), ms("type_infer"), ms("profile_columns"));
 }
@@ -1,20 +1,31 @@
 // src/report/emit_profile_json.hpp
 #pragma once
+#include <cmath>
 #include <string>
 #include <vector>
 #include <fstream>
 #include <cstdint>
+#include <optional>
+#include <fmt/format.h>
 #include "../profile/profile.hpp"
 #include "../util/json_escape.hpp"
 
 namespace csvqr {
 
-// Overload that accepts computed columns
+// shortest round-trip form; JSON has no inf/nan
+inline std::string json_number(double v) {
+    if (!std::isfinite(v)) return "null";
+    return fmt::format("{}", v);
+}
+
+// Overload that accepts computed columns. `sample` marks a sampled profile:
+// rows and null counts are then estimates and carry 95% intervals.
 inline void emit_profile_json(const std::string& out_path,
                               const std::string& source_path,
                               std::uint64_t rows,
                               bool header_present,
-                              const std::vector<ColumnSummary>& cols)
+                              const std::vector<ColumnSummary>& cols,
+                              const std::optional<sample_info>& sample = std::nullopt)
 {
     std::ofstream os(out_path, std::ios::binary);
     if (!os) return;
@@ -26,6 +37,12 @@ inline void emit_profile_json(const std::string& out_path,
     os << "\"columns\":" << cols.size() << ",";
     os << "\"header_present\":" << (header_present ? "true" : "false") << ",";
     os << "\"source_path\":\"" << csvqr::json_escape(source_path) << "\"";
+    if (sample) {
+        os << ",\"sample\":{\"blocks\":" << sample->blocks
+           << ",\"rows_profiled\":" << sample->rows
+           << ",\"fraction\":" << json_number(sample->fraction)
+           << ",\"rows_ci95\":[" << sample->rows_lo << "," << sample->rows_hi << "]}";
+    }
     os << "},\n";
 
     os << "  \"columns\":[";
@@ -36,7 +53,44 @@ inline void emit_profile_json(const std::string& out_path,
         os << "\"name\":\""          << csvqr::json_escape(c.name)         << "\",";
         os << "\"logical_type\":\""  << csvqr::json_escape(c.logical_type) << "\",";
         os << "\"null_count\":"      << c.null_count                        << ",";
+        if (c.null_count_ci)
+            os << "\"null_count_ci95\":[" << c.null_count_ci->first << "," << c.null_count_ci->second << "],";
         os << "\"non_null_count\":"  << c.non_null_count;
+        if (c.min_int)     os << ",\"min\":"    << *c.min_int;
+        else if (c.min_text) os << ",\"min\":\"" << csvqr::json_escape(*c.min_text) << "\"";
+        else if (c.min)    os << ",\"min\":"    << json_number(*c.min);
+        if (c.max_int)     os << ",\"max\":"    << *c.max_int;
+        else if (c.max_text) os << ",\"max\":\"" << csvqr::json_escape(*c.max_text) << "\"";
+        else if (c.max)    os << ",\"max\":"    << json_number(*c.max);
+        if (c.mean)        os << ",\"mean\":"   << json_number(*c.mean);
+        if (c.stddev)      os << ",\"stddev\":" << json_number(*c.stddev);
+        if (c.median)      os << ",\"median\":" << json_number(*c.median);
+        if (c.cardinality) os << ",\"cardinality\":" << *c.cardinality;
+        if (!c.topk.empty()) {
+            os << ",\"topk\":[";
+            for (size_t t = 0; t < c.topk.size(); ++t) {
+                if (t) os << ",";
+                os << "{\"value\":\"" << csvqr::json_escape(c.topk[t].value) << "\",\"count\":" << c.topk[t].count;
+                if (c.topk[t].error > 0) os << ",\"error\":" << c.topk[t].error;
+                os << "}";
+            }
+            os << "]";
+        }
+        if (c.hist) {
+            os << ",\"histogram\":{\"bins\":" << c.hist->bins << ",\"edges\":[";
+            for (size_t e = 0; e < c.hist->edges.size(); ++e) os << (e ? "," : "") << json_number(c.hist->edges[e]);
+            os << "],\"counts\":[";
+            for (size_t k = 0; k < c.hist->counts.size(); ++k) os << (k ? "," : "") << c.hist->counts[k];
+            os << "]}";
+        }
+        if (!c.quantiles.empty()) {
+            os << ",\"quantiles\":{";
+            for (size_t q = 0; q < c.quantiles.size(); ++q) {
+                if (q) os << ",";
+                os << "\"" << fmt::format("{}", c.quantiles[q].first) << "\":" << json_number(c.quantiles[q].second);
+            }
+            os << "}";
+        }
         os << "}";
     }
     os << "]\n";
@@ -1,6 +1,7 @@
 #pragma once
 #include <fmt/format.h>
 #include <fstream>
+#include <optional>
 #include <string>
 #include <vector>
 #include <cstdint>
@@ -10,6 +11,9 @@ struct RunStage {
     std::uint64_t calls = 0;
     double p50_ms = 0.0;
     double p95_ms = 0.0;
+    double p99_ms = 0.0;
+    double max_ms = 0.0;
+    double total_ms = 0.0;   // sum over calls
 };
 
 struct RunSample {
@@ -20,6 +24,22 @@ struct RunSample {
     double cpu_pct = 0.0;        // ALWAYS serialized
 };
 
+// Input side of the scan: where bytes came from, and how long the parse loop
+// sat waiting for them vs. working on them.
+struct RunIo {
+    std::string   backend;          // empty = not reported
+    std::uint64_t read_ahead = 0;   // ring depth (async backend only)
+    double        wait_ms  = 0.0;
+    double        parse_ms = 0.0;
+};
+
+// Arena use of the profiler (omitted when all zero).
+struct RunArena {
+    std::uint64_t scratch_bytes = 0;   // peak per-batch scratch arena
+    std::uint64_t key_bytes     = 0;   // top-k key pools, all columns
+    std::uint64_t interned_keys = 0;   // distinct keys held in those pools
+};
+
 inline void emit_run_json(const std::string& out_path,
                           const std::string& started_iso,
                           const std::string& ended_iso,
@@ -30,7 +50,11 @@ inline void emit_run_json(const std::string& out_path,
                           const std::vector<RunSample>& samples,
                           double rss_peak_mb = 0.0,
                           double cpu_user_pct = 0.0,
-                          double cpu_sys_pct = 0.0)
+                          double cpu_sys_pct = 0.0,
+                          const RunIo& io = {},
+                          std::optional<double> cache_hit_pct = std::nullopt,
+                          std::optional<double> memo_hit_pct = std::nullopt,
+                          const RunArena& arena = {})
 {
     const double mb   = static_cast<double>(input_bytes) / (1024.0 * 1024.0);
     const double secs = wall_ms / 1000.0;
@@ -51,10 +75,21 @@ inline void emit_run_json(const std::string& out_path,
       << "\n  " << fmt::format(R"("cpu_user_pct":{},)", cpu_user_pct)
       << "\n  " << fmt::format(R"("cpu_sys_pct":{},)", cpu_sys_pct)
       << "\n  " << R"("errors":0,)"
-      << "\n  " << R"("cache_hit_pct":null,)"
+      << "\n  " << (cache_hit_pct ? fmt::format(R"("cache_hit_pct":{},)", *cache_hit_pct)
+                                   : std::string(R"("cache_hit_pct":null,)"))
+      << (memo_hit_pct ? "\n  " + fmt::format(R"("memo_hit_pct":{},)", *memo_hit_pct) : std::string())
       << "\n  " << R"("build":{"type":"Debug","flags":""},)"
       << "\n  " << R"("host":{"os":"windows","arch":"x86_64"},)";
 
+    if (!io.backend.empty()) {
+        f << "\n  " << fmt::format(R"("io":{{"backend":"{}",)", io.backend);
+        if (io.read_ahead > 0) f << fmt::format(R"("read_ahead":{},)", io.read_ahead);
+        f << fmt::format(R"("wait_ms":{},"parse_ms":{}}},)", io.wait_ms, io.parse_ms);
+    }
+    if (arena.scratch_bytes || arena.key_bytes || arena.interned_keys)
+        f << "\n  " << fmt::format(R"("arena":{{"scratch_bytes":{},"key_bytes":{},"interned_keys":{}}},)",
+                                   arena.scratch_bytes, arena.key_bytes, arena.interned_keys);
+
     // stages
     f << "\n  \"stages\":[\n";
     for (size_t i = 0; i < stages.size(); ++i) {
@@ -63,6 +98,9 @@ inline void emit_run_json(const std::string& out_path,
           << fmt::format(R"("name":"{}","calls":{})", s.name, s.calls);
         if (s.p50_ms > 0.0) f << fmt::format(R"(,"p50_ms":{})", s.p50_ms);
         if (s.p95_ms > 0.0) f << fmt::format(R"(,"p95_ms":{})", s.p95_ms);
+        if (s.p99_ms > 0.0) f << fmt::format(R"(,"p99_ms":{})", s.p99_ms);
+        if (s.max_ms > 0.0) f << fmt::format(R"(,"max_ms":{})", s.max_ms);
+        if (s.total_ms > 0.0) f << fmt::format(R"(,"total_ms":{})", s.total_ms);
         f << "}";
         if (i + 1 < stages.size()) f << ",";
         f << "\n";
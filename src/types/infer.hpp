@@ -1,36 +1,23 @@
 #pragma once
+#include <cstdint>
 #include <string_view>
 #include <string>
 #include <cctype>
 #include <optional>
 
+#include "parse_number.hpp"
+
 namespace csvqr {
 
 enum class logical_type { int64_, float64_, boolean_, date_, datetime_, string_ };
 
 inline bool is_int64(std::string_view s) {
-    if (s.empty()) return false;
-    std::size_t i = (s[0] == '+' || s[0] == '-') ? 1 : 0;
-    if (i >= s.size()) return false;
-    for (; i < s.size(); ++i) if (!std::isdigit(static_cast<unsigned char>(s[i]))) return false;
-    return true;
+    std::int64_t v;
+    return parse_int64(s, v);
 }
 inline bool is_float64(std::string_view s) {
-    if (s.empty()) return false;
-    bool dot = false, exp = false, digit = false;
-    std::size_t i = (s[0] == '+' || s[0] == '-') ? 1 : 0;
-    for (; i < s.size(); ++i) {
-        char c = s[i];
-        if (std::isdigit(static_cast<unsigned char>(c))) { digit = true; continue; }
-        if (c == '.' && !dot) { dot = true; continue; }
-        if ((c == 'e' || c == 'E') && !exp) {
-            exp = true;
-            if (i + 1 < s.size() && (s[i + 1] == '+' || s[i + 1] == '-')) ++i;
-            continue;
-        }
-        return false;
-    }
-    return digit;
+    double v;
+    return parse_float64(s, v);
 }
 inline bool is_bool(std::string_view s) {
     return s == "true" || s == "false" || s == "TRUE" || s == "FALSE" ||
@@ -56,4 +43,38 @@ inline const char* to_string(logical_type t) {
     }
 }
 
+// ---------- type lattice ----------
+// A column's candidate types as a bit set. Inference only removes candidates:
+// int64 sits below float64 and date below datetime, so ruling out the wider
+// type rules out the narrower one with it; bool is independent. The empty set
+// is string, the top of the lattice, where no further checks run.
+namespace type_bits {
+    constexpr std::uint8_t boolean  = 1;
+    constexpr std::uint8_t int64    = 2;
+    constexpr std::uint8_t float64  = 4;
+    constexpr std::uint8_t date     = 8;
+    constexpr std::uint8_t datetime = 16;
+    constexpr std::uint8_t all      = boolean | int64 | float64 | date | datetime;
+}
+
+// Candidates left after ruling out `gone` (and everything below it).
+inline constexpr std::uint8_t rule_out(std::uint8_t set, std::uint8_t gone) noexcept {
+    if (gone & type_bits::float64)  gone |= type_bits::int64;
+    if (gone & type_bits::datetime) gone |= type_bits::date;
+    return static_cast<std::uint8_t>(set & ~gone);
+}
+
+// Candidate set of a `[types] force` entry: the forced type and the types
+// above it that its values are parsed with (an int64 column still keeps the
+// float64 bit, so cells are parsed once as numbers). nullopt: unknown name.
+inline std::optional<std::uint8_t> forced_type_bits(std::string_view name) {
+    if (name == "int64"   || name == "int")     return std::uint8_t{type_bits::int64 | type_bits::float64};
+    if (name == "float64" || name == "float")   return type_bits::float64;
+    if (name == "bool"    || name == "boolean") return type_bits::boolean;
+    if (name == "date")                         return std::uint8_t{type_bits::date | type_bits::datetime};
+    if (name == "datetime")                     return type_bits::datetime;
+    if (name == "string")                       return std::uint8_t{0};
+    return std::nullopt;
+}
+
 }
@@ -1,20 +1,251 @@
 #pragma once
-#include <string>
-#include <string_view>
-#include <sstream>
-#include <iomanip>
+#include <array>
+#include <cstdint>
+#include <cstdio>
 #include <ctime>
 #include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
 #include <vector>
+
 namespace csvqr {
 
+// ---------- civil calendar (proleptic Gregorian, constexpr) ----------
+constexpr bool is_leap_year(std::int64_t y) noexcept {
+    return (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+}
+
+constexpr int days_in_month(std::int64_t y, int m) noexcept {
+    constexpr std::array<int, 12> k{31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    return (m == 2 && is_leap_year(y)) ? 29 : k[static_cast<std::size_t>(m - 1)];
+}
+
+// Days since 1970-01-01 (H. Hinnant's days_from_civil).
+constexpr std::int64_t days_from_civil(std::int64_t y, int m, int d) noexcept {
+    y -= m <= 2;
+    const std::int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const std::int64_t yoe = y - era * 400;
+    const std::int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const std::int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+struct civil_date { std::int64_t y; int m; int d; };
+
+constexpr civil_date civil_from_days(std::int64_t z) noexcept {
+    z += 719468;
+    const std::int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const std::int64_t doe = z - era * 146097;
+    const std::int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const std::int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const std::int64_t mp  = (5 * doy + 2) / 153;
+    const int d = static_cast<int>(doy - (153 * mp + 2) / 5 + 1);
+    const int m = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+    return {yoe + era * 400 + (m <= 2), m, d};
+}
+
+static_assert(days_from_civil(1970, 1, 1) == 0);
+static_assert(days_from_civil(2000, 3, 1) == 11017);
+static_assert(civil_from_days(11017).m == 3);
+
+// A parsed, fully validated date or datetime.
+struct date_value {
+    std::int64_t days    = 0;   // since 1970-01-01
+    std::int64_t seconds = 0;   // since 1970-01-01T00:00:00 (days * 86400 + time of day)
+    bool         has_time = false;
+};
+
+// ---------- compiled formats ----------
+// A strftime-style format compiled once into a list of field ops, so a cell is
+// matched in one left-to-right pass with no allocation and no locale.
+// Supported: %Y (4 digits), %m %d %H %M %S (1-2 digits), %% and literal bytes.
+// "%Y-%m-%d" style formats (any single separator) get a fixed-width fast path.
+class date_format {
+public:
+    explicit date_format(std::string_view fmt) : text_(fmt) {
+        for (std::size_t i = 0; i < fmt.size(); ++i) {
+            if (fmt[i] != '%') { ops_.push_back({op::literal, fmt[i]}); continue; }
+            if (++i == fmt.size()) throw std::invalid_argument("date format ends with '%': " + text_);
+            switch (fmt[i]) {
+                case 'Y': ops_.push_back({op::year, 0});   break;
+                case 'm': ops_.push_back({op::month, 0});  break;
+                case 'd': ops_.push_back({op::day, 0});    break;
+                case 'H': ops_.push_back({op::hour, 0});   has_time_ = true; break;
+                case 'M': ops_.push_back({op::minute, 0}); has_time_ = true; break;
+                case 'S': ops_.push_back({op::second, 0}); has_time_ = true; break;
+                case '%': ops_.push_back({op::literal, '%'}); break;
+                default:
+                    throw std::invalid_argument("unsupported date directive %" + std::string(1, fmt[i]) +
+                                                " in: " + text_);
+            }
+        }
+        bool y = false, m = false, d = false;
+        for (const auto& o : ops_) { y |= o.kind == op::year; m |= o.kind == op::month; d |= o.kind == op::day; }
+        if (!y || !m || !d) throw std::invalid_argument("date format needs %Y, %m and %d: " + text_);
+
+        // a field right after a field, or a digit literal, lets digits move
+        // between ops; otherwise a match's non-digit bytes are the literals
+        literals_only_ = true;
+        for (std::size_t i = 0; i < ops_.size(); ++i) {
+            if (ops_[i].kind == op::literal) {
+                literals_.push_back(ops_[i].ch);
+                if (is_digit(ops_[i].ch)) literals_only_ = false;
+            } else if (i > 0 && ops_[i - 1].kind != op::literal) {
+                literals_only_ = false;
+            }
+        }
+
+        ymd_sep_ = (ops_.size() == 5 && ops_[0].kind == op::year && ops_[1].kind == op::literal &&
+                    ops_[2].kind == op::month && ops_[3].kind == op::literal && ops_[1].ch == ops_[3].ch &&
+                    ops_[4].kind == op::day) ? ops_[1].ch : '\0';
+    }
+
+    bool has_time() const noexcept { return has_time_; }
+    const std::string& text() const noexcept { return text_; }
+
+    // True if no text can match both formats (their literals differ and
+    // neither lets a digit run span two ops); false when unsure.
+    bool disjoint_from(const date_format& o) const noexcept {
+        return literals_only_ && o.literals_only_ && literals_ != o.literals_;
+    }
+
+    std::optional<date_value> parse(std::string_view s) const noexcept {
+        if (ymd_sep_) return parse_ymd(s, ymd_sep_);
+        int f[6] = {0, 1, 1, 0, 0, 0};   // Y m d H M S
+        std::size_t p = 0;
+        for (const auto& o : ops_) {
+            if (o.kind == op::literal) {
+                if (p >= s.size() || s[p] != o.ch) return std::nullopt;
+                ++p;
+                continue;
+            }
+            const int width = o.kind == op::year ? 4 : 2;
+            const int min_w = o.kind == op::year ? 4 : 1;
+            int v = 0, n = 0;
+            while (n < width && p < s.size() && is_digit(s[p])) { v = v * 10 + (s[p] - '0'); ++p; ++n; }
+            if (n < min_w) return std::nullopt;
+            f[static_cast<int>(o.kind)] = v;
+        }
+        if (p != s.size()) return std::nullopt;
+        return make(f[0], f[1], f[2], f[3], f[4], f[5], has_time_);
+    }
+
+private:
+    enum class op : std::uint8_t { year = 0, month = 1, day = 2, hour = 3, minute = 4, second = 5, literal };
+    struct step { op kind; char ch; };
+
+    static constexpr bool is_digit(char c) noexcept { return c >= '0' && c <= '9'; }
+    static constexpr int  dig(char c) noexcept { return c - '0'; }
+
+    static std::optional<date_value> make(int y, int m, int d, int hh, int mm, int ss, bool has_time) noexcept {
+        if (m < 1 || m > 12 || d < 1 || d > days_in_month(y, m)) return std::nullopt;
+        if (hh > 23 || mm > 59 || ss > 60) return std::nullopt;   // 60 = leap second
+        date_value v;
+        v.days     = days_from_civil(y, m, d);
+        v.seconds  = v.days * 86400 + hh * 3600 + mm * 60 + ss;
+        v.has_time = has_time;
+        return v;
+    }
+
+    // YYYY<sep>MM<sep>DD, fixed width
+    static std::optional<date_value> parse_ymd(std::string_view s, char sep) noexcept {
+        if (s.size() != 10 || s[4] != sep || s[7] != sep) return std::nullopt;
+        for (int i : {0, 1, 2, 3, 5, 6, 8, 9}) if (!is_digit(s[static_cast<std::size_t>(i)])) return std::nullopt;
+        const int y = dig(s[0]) * 1000 + dig(s[1]) * 100 + dig(s[2]) * 10 + dig(s[3]);
+        const int m = dig(s[5]) * 10 + dig(s[6]);
+        const int d = dig(s[8]) * 10 + dig(s[9]);
+        return make(y, m, d, 0, 0, 0, false);
+    }
+
+    std::string       text_;
+    std::vector<step> ops_;
+    bool              has_time_ = false;
+    char              ymd_sep_  = '\0';
+    std::string       literals_;               // the literal bytes, in order
+    bool              literals_only_ = false;  // see disjoint_from
+};
+
+inline std::vector<std::string> default_date_formats() {
+    return {"%Y-%m-%d", "%m/%d/%Y"};
+}
+inline std::vector<std::string> default_datetime_formats() {
+    return {"%Y-%m-%dT%H:%M:%S", "%Y-%m-%d %H:%M:%S", "%Y-%m-%dT%H:%M:%SZ"};
+}
+
+// Ordered set of compiled formats; the first that matches wins. A column keeps
+// hitting the same format, so the last successful one is tried first, but
+// only when no earlier format can match the same text: with overlapping
+// formats (%m/%d/%Y and %d/%m/%Y) the list order decides, not the previous
+// cell, so the verdict does not depend on how the column was split.
+class date_parser {
+public:
+    date_parser() : date_parser(default_date_formats(), default_datetime_formats()) {}
+    date_parser(const std::vector<std::string>& date_fmts, const std::vector<std::string>& datetime_fmts) {
+        for (const auto& f : date_fmts)     formats_.emplace_back(f);
+        for (const auto& f : datetime_fmts) formats_.emplace_back(f);
+        for (std::size_t j = 0; j < formats_.size(); ++j) {
+            bool first = true;
+            for (std::size_t i = 0; i < j && first; ++i) first = formats_[i].disjoint_from(formats_[j]);
+            hint_first_.push_back(first);
+        }
+    }
+
+    std::optional<date_value> parse(std::string_view s, std::size_t& hint) const noexcept {
+        if (formats_.empty()) return std::nullopt;
+        const bool ahead = hint < formats_.size() && hint_first_[hint];
+        if (ahead)
+            if (auto v = formats_[hint].parse(s)) return v;
+        for (std::size_t i = 0; i < formats_.size(); ++i) {
+            if (ahead && i == hint) continue;
+            if (auto v = formats_[i].parse(s)) { hint = i; return v; }
+        }
+        return std::nullopt;
+    }
+    std::optional<date_value> parse(std::string_view s) const noexcept {
+        std::size_t hint = 0;
+        return parse(s, hint);
+    }
+
+    bool empty() const noexcept { return formats_.empty(); }
+
+private:
+    std::vector<date_format> formats_;
+    std::vector<bool>        hint_first_;   // per format: no earlier one overlaps it
+};
+
+// ISO-8601 text of a parsed value: YYYY-MM-DD or YYYY-MM-DDTHH:MM:SS.
+inline std::string format_date_value(std::int64_t seconds, bool with_time) {
+    std::int64_t days = seconds / 86400, sod = seconds % 86400;
+    if (sod < 0) { sod += 86400; --days; }
+    const civil_date c = civil_from_days(days);
+    char buf[32];
+    int n = 0;
+    if (with_time)
+        n = std::snprintf(buf, sizeof buf, "%04lld-%02d-%02dT%02d:%02d:%02d",
+                          static_cast<long long>(c.y), c.m, c.d,
+                          static_cast<int>(sod / 3600), static_cast<int>(sod / 60 % 60), static_cast<int>(sod % 60));
+    else
+        n = std::snprintf(buf, sizeof buf, "%04lld-%02d-%02d", static_cast<long long>(c.y), c.m, c.d);
+    return std::string(buf, n > 0 ? static_cast<std::size_t>(n) : 0);
+}
+
+// Legacy entry point (first matching format wins); no streams, no locale.
 inline std::optional<std::tm> parse_date_any(std::string_view s,
                                              const std::vector<std::string>& fmts) {
-    for (const auto& fmt : fmts) {
+    for (const auto& f : fmts) {
+        const auto v = date_format(f).parse(s);
+        if (!v) continue;
+        const civil_date c = civil_from_days(v->days);
+        const std::int64_t sod = v->seconds - v->days * 86400;
         std::tm tm{};
-        std::istringstream iss(std::string{s});
-        iss >> std::get_time(&tm, fmt.c_str());
-        if (!iss.fail()) return tm;
+        tm.tm_year = static_cast<int>(c.y - 1900);
+        tm.tm_mon  = c.m - 1;
+        tm.tm_mday = c.d;
+        tm.tm_hour = static_cast<int>(sod / 3600);
+        tm.tm_min  = static_cast<int>(sod / 60 % 60);
+        tm.tm_sec  = static_cast<int>(sod % 60);
+        return tm;
     }
     return std::nullopt;
 }
@@ -0,0 +1,72 @@
+#pragma once
+#include <charconv>
+#include <cstdint>
+#include <string_view>
+#include <system_error>
+
+#include <fast_float/fast_float.h>
+
+namespace csvqr {
+
+// One parse per cell: the type verdict and the value come out together.
+// Input is expected trimmed; the whole view must be consumed.
+//  - int64:   optional sign + digits that fit in int64 (std::from_chars)
+//  - float64: anything fast_float accepts (decimal, exponent, inf/nan),
+//             including integers that overflow int64 (demoted, not rejected)
+// Locale-independent; never allocates.
+struct numeric_value {
+    enum kind_t : std::uint8_t { none, int64, float64 };
+    kind_t        kind = none;
+    std::int64_t  i    = 0;      // valid when kind == int64
+    double        d    = 0.0;    // valid when kind != none (int64 converted)
+
+    explicit operator bool() const noexcept { return kind != none; }
+    bool is_int() const noexcept { return kind == int64; }
+};
+
+namespace detail {
+// from_chars/fast_float reject a leading '+'; strip it unless a sign follows.
+inline bool strip_plus(const char*& first, const char* last) noexcept {
+    if (first == last || *first != '+') return true;
+    ++first;
+    return first != last && *first != '-' && *first != '+';
+}
+}
+
+inline bool parse_int64(std::string_view s, std::int64_t& out) noexcept {
+    const char* f = s.data();
+    const char* l = f + s.size();
+    if (!detail::strip_plus(f, l) || f == l) return false;
+    const auto r = std::from_chars(f, l, out);
+    return r.ec == std::errc{} && r.ptr == l;
+}
+
+inline bool parse_float64(std::string_view s, double& out) noexcept {
+    const char* f = s.data();
+    const char* l = f + s.size();
+    if (!detail::strip_plus(f, l) || f == l) return false;
+    const auto r = fast_float::from_chars(f, l, out);
+    return r.ec == std::errc{} && r.ptr == l;
+}
+
+inline numeric_value parse_numeric(std::string_view s) noexcept {
+    numeric_value v;
+    if (s.empty()) return v;
+    const char* f = s.data();
+    const char* l = f + s.size();
+    if (!detail::strip_plus(f, l) || f == l) return v;
+
+    const auto ri = std::from_chars(f, l, v.i);
+    if (ri.ec == std::errc{} && ri.ptr == l) {
+        v.kind = numeric_value::int64;
+        v.d    = static_cast<double>(v.i);
+        return v;
+    }
+    // not an int64 (fraction, exponent, or out of range): try as a double
+    const auto rd = fast_float::from_chars(f, l, v.d);
+    if (rd.ec == std::errc{} && rd.ptr == l) v.kind = numeric_value::float64;
+    v.i = 0;
+    return v;
+}
+
+}
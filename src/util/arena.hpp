@@ -0,0 +1,95 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace csvqr {
+
+// Monotonic bump allocator for short-lived bytes (e.g. unescaped fields of the
+// current batch). Allocation is a pointer bump; reset() rewinds everything at
+// once and keeps the largest block, so a steady-state batch loop stops calling
+// malloc after warm-up. Views into the arena die at reset().
+class arena {
+public:
+    explicit arena(std::size_t block_bytes = 64 * 1024) : block_bytes_(block_bytes ? block_bytes : 64) {}
+    arena(const arena&) = delete;
+    arena& operator=(const arena&) = delete;
+    arena(arena&&) noexcept = default;
+    arena& operator=(arena&&) noexcept = default;
+
+    char* allocate(std::size_t n) {
+        if (blocks_.empty() || blocks_[cur_].size - used_ < n) next_block(n);
+        char* p = blocks_[cur_].data.get() + used_;
+        used_ += n;
+        bytes_used_ += n;
+        last_ = p;
+        return p;
+    }
+
+    // Gives back the tail of the most recent allocation (worst-case sizing).
+    void shrink_last(char* p, std::size_t old_n, std::size_t new_n) noexcept {
+        if (p != last_ || new_n > old_n) return;
+        used_ -= old_n - new_n;
+        bytes_used_ -= old_n - new_n;
+    }
+
+    std::string_view store(std::string_view s) {
+        if (s.empty()) return {};
+        char* p = allocate(s.size());
+        std::memcpy(p, s.data(), s.size());
+        return {p, s.size()};
+    }
+
+    // Drops every allocation; keeps the biggest block for reuse.
+    void reset() noexcept {
+        if (blocks_.size() > 1) {
+            std::size_t big = 0;
+            for (std::size_t i = 1; i < blocks_.size(); ++i)
+                if (blocks_[i].size > blocks_[big].size) big = i;
+            block b = std::move(blocks_[big]);
+            blocks_.clear();
+            blocks_.push_back(std::move(b));
+        }
+        cur_ = 0;
+        used_ = 0;
+        bytes_used_ = 0;
+        last_ = nullptr;
+    }
+
+    std::size_t bytes_used()     const noexcept { return bytes_used_; }
+    std::size_t bytes_reserved() const noexcept {
+        std::size_t n = 0;
+        for (const auto& b : blocks_) n += b.size;
+        return n;
+    }
+
+private:
+    struct block {
+        std::unique_ptr<char[]> data;
+        std::size_t size = 0;
+    };
+
+    void next_block(std::size_t need) {
+        // reuse a later block kept from before a reset, else grow
+        if (!blocks_.empty() && cur_ + 1 < blocks_.size() && blocks_[cur_ + 1].size >= need) {
+            ++cur_;
+            used_ = 0;
+            return;
+        }
+        const std::size_t sz = need > block_bytes_ ? need : block_bytes_;
+        blocks_.push_back(block{std::unique_ptr<char[]>(new char[sz]), sz});
+        cur_ = blocks_.size() - 1;
+        used_ = 0;
+    }
+
+    std::size_t        block_bytes_;
+    std::vector<block> blocks_;
+    std::size_t        cur_        = 0;
+    std::size_t        used_       = 0;
+    std::size_t        bytes_used_ = 0;
+    char*              last_       = nullptr;
+};
+
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#if defined(_MSC_VER) && !defined(__clang__) && defined(_M_X64)
+  #include <intrin.h>
+#endif
+
+namespace csvqr {
+
+// 64x64 -> 128 multiply, folded (the wyhash "mum" step).
+inline std::uint64_t mul_fold64(std::uint64_t a, std::uint64_t b) noexcept {
+#if defined(__SIZEOF_INT128__)
+    __extension__ typedef unsigned __int128 u128;   // __extension__: quiet -Wpedantic
+    const u128 r = static_cast<u128>(a) * b;
+    return static_cast<std::uint64_t>(r) ^ static_cast<std::uint64_t>(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    std::uint64_t hi = 0;
+    const std::uint64_t lo = _umul128(a, b, &hi);
+    return lo ^ hi;
+#else
+    const std::uint64_t a_lo = a & 0xffffffffu, a_hi = a >> 32;
+    const std::uint64_t b_lo = b & 0xffffffffu, b_hi = b >> 32;
+    const std::uint64_t ll = a_lo * b_lo, lh = a_lo * b_hi, hl = a_hi * b_lo, hh = a_hi * b_hi;
+    const std::uint64_t mid = (ll >> 32) + (lh & 0xffffffffu) + (hl & 0xffffffffu);
+    const std::uint64_t lo = (ll & 0xffffffffu) | (mid << 32);
+    const std::uint64_t hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+    return lo ^ hi;
+#endif
+}
+
+inline std::uint64_t load_le64(const unsigned char* p) noexcept {
+    std::uint64_t v;
+    std::memcpy(&v, p, 8);   // little-endian hosts only (x86-64, arm64)
+    return v;
+}
+inline std::uint64_t load_le32(const unsigned char* p) noexcept {
+    std::uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+// Fast non-cryptographic 64-bit hash of a byte string (wyhash-style: 16 bytes
+// per multiply). Used for heavy-hitter and distinct-count sketches, so the
+// output is avalanche-mixed in every bit. Short keys (most CSV cells) are read
+// with overlapping fixed-size loads, never a variable-length copy.
+inline std::uint64_t hash64(std::string_view s, std::uint64_t seed = 0) noexcept {
+    constexpr std::uint64_t k0 = 0xa0761d6478bd642full, k1 = 0xe7037ed1a0b428dbull,
+                            k2 = 0x8ebc6af09c88c6e3ull;
+    const auto* p = reinterpret_cast<const unsigned char*>(s.data());
+    const std::size_t n = s.size();
+    std::uint64_t h = seed ^ mul_fold64(seed ^ k0, k1);
+    std::uint64_t a = 0, b = 0;
+
+    if (n <= 16) {
+        if (n >= 4) {
+            const std::size_t q = (n >> 3) << 2;   // 0 or 4: second word of each half
+            a = (load_le32(p) << 32) | load_le32(p + q);
+            b = (load_le32(p + n - 4) << 32) | load_le32(p + n - 4 - q);
+        } else if (n > 0) {
+            a = (std::uint64_t{p[0]} << 16) | (std::uint64_t{p[n >> 1]} << 8) | p[n - 1];
+        }
+    } else {
+        std::size_t i = n;
+        while (i > 16) {
+            h = mul_fold64(load_le64(p) ^ k1, load_le64(p + 8) ^ h);
+            p += 16;
+            i -= 16;
+        }
+        a = load_le64(p + i - 16);   // last 16 bytes, overlapping what was mixed
+        b = load_le64(p + i - 8);
+    }
+    h = mul_fold64(a ^ k1, b ^ h);
+    return mul_fold64(h ^ k2, static_cast<std::uint64_t>(n) ^ k1);
+}
+
+}
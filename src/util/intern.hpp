@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "arena.hpp"
+#include "hash.hpp"
+
+namespace csvqr {
+
+// Long-lived string pool: each distinct value is copied into the arena once
+// and every intern() of equal bytes returns the same view, so repeated keys
+// (a category value that is evicted and comes back, a key seen by several
+// merged summaries) share storage. Lookup is one probe of an open-addressing
+// table of hashes; the caller usually has the hash already. Views live until
+// clear() or destruction; a moved-from pool's views stay valid in the target.
+class string_interner {
+public:
+    explicit string_interner(std::size_t block_bytes = 4096) : bytes_(block_bytes) {}
+
+    std::string_view intern(std::string_view s) { return intern(s, hash64(s)); }
+
+    std::string_view intern(std::string_view s, std::uint64_t h) {
+        if (s.empty()) return {};
+        if ((n_ + 1) * 4 > slots_.size() * 3) grow();
+        const std::size_t mask = slots_.size() - 1;
+        for (std::size_t i = static_cast<std::size_t>(h) & mask;; i = (i + 1) & mask) {
+            slot& sl = slots_[i];
+            if (sl.key.data() == nullptr) {
+                sl = slot{h, bytes_.store(s)};
+                ++n_;
+                return sl.key;
+            }
+            if (sl.hash == h && sl.key == s) return sl.key;
+        }
+    }
+
+    std::size_t size()           const noexcept { return n_; }
+    std::size_t bytes_used()     const noexcept { return bytes_.bytes_used(); }
+    std::size_t bytes_reserved() const noexcept {
+        return bytes_.bytes_reserved() + slots_.capacity() * sizeof(slot);
+    }
+
+    void clear() noexcept {
+        bytes_.reset();
+        slots_.clear();
+        n_ = 0;
+    }
+
+private:
+    struct slot {
+        std::uint64_t    hash = 0;
+        std::string_view key;        // null data: empty slot
+    };
+
+    void grow() {
+        std::vector<slot> old(slots_.empty() ? 16 : slots_.size() * 2);
+        old.swap(slots_);
+        const std::size_t mask = slots_.size() - 1;
+        for (const slot& sl : old) {
+            if (sl.key.data() == nullptr) continue;
+            std::size_t i = static_cast<std::size_t>(sl.hash) & mask;
+            while (slots_[i].key.data() != nullptr) i = (i + 1) & mask;
+            slots_[i] = sl;
+        }
+    }
+
+    arena             bytes_;
+    std::vector<slot> slots_;
+    std::size_t       n_ = 0;
+};
+
+}
@@ -1,4 +1,7 @@
 #pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <string_view>
 #include <string>
 #include <vector>
@@ -6,6 +9,78 @@
 
 namespace csvqr {
 
+inline std::vector<std::string> default_null_tokens() {
+    return {"", "NA", "N/A", "null", "NULL", "NaN"};
+}
+
+// Null tokens (config [nulls] values) compiled once for per-cell matching.
+// Cells are expected trimmed (see trim_view); tokens are trimmed when
+// compiled. Tokens are grouped by length, and each length keeps a 256-bit set
+// of (folded) first bytes, so a typical non-null cell is rejected by a length
+// compare or one bit test before any byte comparison.
+class null_matcher {
+public:
+    null_matcher() : null_matcher(default_null_tokens()) {}
+    explicit null_matcher(const std::vector<std::string>& tokens, bool case_insensitive = true)
+        : fold_case_(case_insensitive) {
+        for (const auto& raw : tokens) {
+            std::string t(trim(raw));
+            if (fold_case_) for (auto& c : t) c = static_cast<char>(fold(c));
+            if (t.size() >= by_len_.size()) by_len_.resize(t.size() + 1);
+            bucket& b = by_len_[t.size()];
+            if (std::find(b.tokens.begin(), b.tokens.end(), t) != b.tokens.end()) continue;
+            if (!t.empty()) {
+                const unsigned char f = static_cast<unsigned char>(t[0]);
+                b.first[f >> 6] |= std::uint64_t{1} << (f & 63);
+            }
+            b.tokens.push_back(std::move(t));
+        }
+        empty_ = !by_len_.empty() && !by_len_[0].tokens.empty();
+    }
+
+    bool matches(std::string_view t) const noexcept {
+        if (t.empty()) return empty_;
+        if (t.size() >= by_len_.size()) return false;
+        const bucket& b = by_len_[t.size()];
+        const unsigned char f = fold_case_ ? fold(t[0]) : static_cast<unsigned char>(t[0]);
+        if (!((b.first[f >> 6] >> (f & 63)) & 1u)) return false;
+        for (const auto& tok : b.tokens)
+            if (equal(t, tok)) return true;
+        return false;
+    }
+    bool operator()(std::string_view t) const noexcept { return matches(t); }
+
+    bool empty() const noexcept { return by_len_.empty(); }
+
+private:
+    struct bucket {
+        std::array<std::uint64_t, 4> first{};
+        std::vector<std::string>     tokens;   // folded when case-insensitive
+    };
+
+    static unsigned char fold(char c) noexcept {
+        const auto u = static_cast<unsigned char>(c);
+        return (u >= 'A' && u <= 'Z') ? static_cast<unsigned char>(u + 32) : u;
+    }
+    static std::string_view trim(std::string_view s) noexcept {
+        auto sp = [](char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f'; };
+        while (!s.empty() && sp(s.front())) s.remove_prefix(1);
+        while (!s.empty() && sp(s.back()))  s.remove_suffix(1);
+        return s;
+    }
+    bool equal(std::string_view t, const std::string& tok) const noexcept {
+        if (!fold_case_) return t == tok;
+        for (std::size_t i = 0; i < t.size(); ++i)
+            if (fold(t[i]) != static_cast<unsigned char>(tok[i])) return false;
+        return true;
+    }
+
+    bool                fold_case_ = true;
+    bool                empty_     = false;
+    std::vector<bucket> by_len_;   // index = token length
+};
+
+// Case-sensitive one-off check; hot paths should build a null_matcher once.
 inline bool is_null_like(std::string_view s, const std::vector<std::string>& nulls) {
     for (const auto& n : nulls) {
         if (s == n) return true;
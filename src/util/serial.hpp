@@ -0,0 +1,83 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace csvqr {
+
+// Flat binary encoding of accumulator state (profile cache, incremental
+// runs). Values are stored in host byte order with no padding: the bytes are
+// only ever read back on the machine that wrote them, and the file carrying
+// them is versioned by its owner.
+class byte_writer {
+public:
+    template <class T>
+    void put(const T& v) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        out_.append(reinterpret_cast<const char*>(&v), sizeof(T));
+    }
+    void put_str(std::string_view s) {
+        put<std::uint64_t>(s.size());
+        out_.append(s.data(), s.size());
+    }
+    template <class T>
+    void put_vec(const std::vector<T>& v) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        put<std::uint64_t>(v.size());
+        if (!v.empty()) out_.append(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+    }
+
+    const std::string& bytes() const noexcept { return out_; }
+    std::string take() noexcept { return std::move(out_); }
+
+private:
+    std::string out_;
+};
+
+// Reads what a byte_writer wrote, in the same order. Running past the end
+// throws std::runtime_error, so truncated or foreign input is rejected rather
+// than read as garbage.
+class byte_reader {
+public:
+    explicit byte_reader(std::string_view in) : in_(in) {}
+
+    template <class T>
+    T get() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T v;
+        std::memcpy(&v, take(sizeof(T)), sizeof(T));
+        return v;
+    }
+    std::string get_str() {
+        const auto n = get<std::uint64_t>();
+        return std::string(take(n), n);
+    }
+    template <class T>
+    std::vector<T> get_vec() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const auto n = get<std::uint64_t>();
+        if (n > in_.size() / sizeof(T)) throw std::runtime_error("serialized state is truncated");
+        std::vector<T> v(n);
+        if (n) std::memcpy(v.data(), take(n * sizeof(T)), n * sizeof(T));
+        return v;
+    }
+
+    bool at_end() const noexcept { return in_.empty(); }
+
+private:
+    const char* take(std::size_t n) {
+        if (n > in_.size()) throw std::runtime_error("serialized state is truncated");
+        const char* p = in_.data();
+        in_.remove_prefix(n);
+        return p;
+    }
+
+    std::string_view in_;
+};
+
+}
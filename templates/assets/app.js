@@ -70,16 +70,20 @@
     var tbody = $("#stages-table tbody");
     if (tbody) {
       if (!stages.length) {
-        tbody.innerHTML = '<tr><td colspan="4" class="small">No stages recorded.</td></tr>';
+        tbody.innerHTML = '<tr><td colspan="7" class="small">No stages recorded.</td></tr>';
       } else {
         var rowsHtml = [];
         for (var i=0;i<stages.length;i++){
           var s = stages[i];
           var p50 = (s.p50_ms != null && typeof s.p50_ms === "number") ? s.p50_ms.toFixed(3) : "—";
           var p95 = (s.p95_ms != null && typeof s.p95_ms === "number") ? s.p95_ms.toFixed(3) : "—";
+          var p99 = (s.p99_ms != null && typeof s.p99_ms === "number") ? s.p99_ms.toFixed(3) : "—";
+          var max = (s.max_ms != null && typeof s.max_ms === "number") ? s.max_ms.toFixed(3) : "—";
+          var tot = (s.total_ms != null && typeof s.total_ms === "number") ? s.total_ms.toFixed(3) : "—";
           rowsHtml.push(
             "<tr><td>" + (s.name || "(unnamed)") + "</td><td>" +
-            (s.calls != null ? s.calls : 0) + "</td><td>" + p50 + "</td><td>" + p95 + "</td></tr>"
+            (s.calls != null ? s.calls : 0) + "</td><td>" + p50 + "</td><td>" + p95 + "</td><td>" +
+            p99 + "</td><td>" + max + "</td><td>" + tot + "</td></tr>"
           );
         }
         tbody.innerHTML = rowsHtml.join("");
@@ -171,13 +175,14 @@
       });
     })();
 
-    // -------- Stages p95: BAR (unchanged) --------
+    // -------- Stages total time: BAR (p95 for runs without totals) --------
     (function(){
       if (!stages.length){ setText($("#chart-stage"), "No stage metrics."); return; }
       var arr = [];
       for (var i=0;i<stages.length;i++){
         var st = stages[i];
-        arr.push({ name: st.name || "(unnamed)", v: +(st.p95_ms || 0), calls: +(st.calls || 0) });
+        arr.push({ name: st.name || "(unnamed)", v: +(st.total_ms || st.p95_ms || 0),
+                   p95: +(st.p95_ms || 0), calls: +(st.calls || 0) });
       }
       tryEmbed("#chart-stage", {
         $schema:"https://vega.github.io/schema/vega-lite/v5.json",
@@ -186,8 +191,9 @@
         mark:"bar",
         encoding:{
           x:{ field:"name", type:"nominal", title:null },
-          y:{ field:"v", type:"quantitative", title:"p95 (ms)" },
-          tooltip:[ {field:"name", title:"stage"}, {field:"v", title:"p95 (ms)", format:".3f"}, {field:"calls", title:"calls"} ]
+          y:{ field:"v", type:"quantitative", title:"total (ms)" },
+          tooltip:[ {field:"name", title:"stage"}, {field:"v", title:"total (ms)", format:".3f"},
+                    {field:"p95", title:"p95 (ms)", format:".3f"}, {field:"calls", title:"calls"} ]
         }
       });
     })();
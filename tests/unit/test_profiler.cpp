@@ -1,3 +1,793 @@
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <string>
+#include <string_view>
+
+#include "profile/parallel_profile.hpp"
+#include "profile/profile.hpp"
+#include "profile/sample_profile.hpp"
+#include "pipeline/fused_scan.hpp"
 
 TEST(Profiler, SkeletonPasses) { SUCCEED(); }
+
+TEST(Profiler, ColumnProfilerInfersTypesAndNulls) {
+    csvqr::column_profiler prof(',', '"', /*header_present*/ true);
+    for (std::string_view rec : {"id,score,flag,day,name",
+                                 "1,1.5,true,2024-01-01,alpha",
+                                 "2,NA,false,2024-01-02,\"b,c\"",
+                                 "3,2,yes,,NULL"})
+        prof.add_record(rec);
+
+    const auto pr = prof.finish();
+    ASSERT_EQ(pr.rows, 3u);
+    ASSERT_EQ(pr.columns.size(), 5u);
+    EXPECT_EQ(pr.columns[0].logical_type, "int");
+    EXPECT_EQ(pr.columns[1].logical_type, "float");
+    EXPECT_EQ(pr.columns[1].null_count, 1u);
+    EXPECT_EQ(pr.columns[2].logical_type, "bool");
+    EXPECT_EQ(pr.columns[3].logical_type, "date");
+    EXPECT_EQ(pr.columns[4].name, "name");
+    EXPECT_EQ(pr.columns[4].logical_type, "string");
+    EXPECT_EQ(pr.columns[4].non_null_count, 2u);
+}
+
+TEST(Profiler, BatchSizeDoesNotChangeResult) {
+    std::string csv = "a,b,c\n";
+    for (int i = 0; i < 50; ++i)
+        csv += std::to_string(i) + "," + (i % 7 == 0 ? "" : std::to_string(i) + ".5") + ",\"x" +
+               std::to_string(i) + "\"\"y\"\n";
+    csv += "51,2\n52,3,z,extra\n";
+
+    auto run = [&](std::size_t batch_rows, std::size_t chunk) {
+        csvqr::profile_options popt;
+        popt.batch_rows = batch_rows;
+        csvqr::column_profiler prof(',', '"', true, popt);
+        csvqr::record_splitter split('"');
+        auto on_rec = [&](std::string_view r) { prof.add_record(r); };
+        for (std::size_t off = 0; off < csv.size(); off += chunk) {
+            const std::string_view w = std::string_view(csv).substr(off, chunk);
+            prof.begin_chunk(w);
+            split.feed(w, on_rec);
+            prof.end_batch();
+        }
+        split.finish(on_rec);
+        return prof.finish();
+    };
+
+    const auto ref = run(4096, csv.size());
+    ASSERT_EQ(ref.rows, 52u);
+    ASSERT_EQ(ref.columns.size(), 4u);
+    EXPECT_EQ(ref.columns[1].logical_type, "float");
+    EXPECT_EQ(ref.columns[1].null_count, 8u);
+    EXPECT_EQ(ref.columns[2].null_count, 1u);   // the short row
+    EXPECT_EQ(ref.columns[3].non_null_count, 1u);
+    for (std::size_t batch : {1u, 3u, 16u}) {
+        for (std::size_t chunk : {7u, 64u}) {
+            const auto got = run(batch, chunk);
+            ASSERT_EQ(got.rows, ref.rows);
+            ASSERT_EQ(got.columns.size(), ref.columns.size());
+            for (std::size_t c = 0; c < ref.columns.size(); ++c) {
+                EXPECT_EQ(got.columns[c].logical_type, ref.columns[c].logical_type) << c;
+                EXPECT_EQ(got.columns[c].null_count, ref.columns[c].null_count) << c;
+                EXPECT_EQ(got.columns[c].non_null_count, ref.columns[c].non_null_count) << c;
+            }
+        }
+    }
+}
+
+TEST(Profiler, NumericParseRangeChecksAndDemotes) {
+    std::int64_t i = 0;
+    double d = 0.0;
+    EXPECT_TRUE(csvqr::parse_int64("+42", i));
+    EXPECT_EQ(i, 42);
+    EXPECT_TRUE(csvqr::parse_int64("-9223372036854775808", i));
+    EXPECT_FALSE(csvqr::parse_int64("9223372036854775808", i));
+    EXPECT_FALSE(csvqr::parse_int64("+-1", i));
+    EXPECT_FALSE(csvqr::parse_int64("12a", i));
+    EXPECT_TRUE(csvqr::parse_float64("1.5e3", d));
+    EXPECT_DOUBLE_EQ(d, 1500.0);
+    EXPECT_FALSE(csvqr::parse_float64("1.5.", d));
+
+    const auto big = csvqr::parse_numeric("18446744073709551616");
+    EXPECT_EQ(big.kind, csvqr::numeric_value::float64);
+    EXPECT_DOUBLE_EQ(big.d, 18446744073709551616.0);
+    EXPECT_TRUE(csvqr::parse_numeric("-7").is_int());
+    EXPECT_FALSE(csvqr::parse_numeric("abc"));
+
+    csvqr::column_profiler prof(',', '"', true);
+    for (std::string_view rec : {"n,big", "1,5", "3,9223372036854775808", "-4,1"})
+        prof.add_record(rec);
+    const auto pr = prof.finish();
+    EXPECT_EQ(pr.columns[0].logical_type, "int");
+    EXPECT_EQ(*pr.columns[0].min_int, -4);
+    EXPECT_EQ(*pr.columns[0].max_int, 3);
+    EXPECT_DOUBLE_EQ(*pr.columns[0].mean, 0.0);
+    EXPECT_EQ(pr.columns[1].logical_type, "float");
+    EXPECT_FALSE(pr.columns[1].min_int.has_value());
+    EXPECT_DOUBLE_EQ(*pr.columns[1].min, 1.0);
+}
+
+TEST(Profiler, DateParserValidatesAndReturnsEpoch) {
+    const csvqr::date_parser p;
+    const auto d = p.parse("2024-02-29");
+    ASSERT_TRUE(d.has_value());
+    EXPECT_EQ(d->days, 19782);
+    EXPECT_FALSE(d->has_time);
+    EXPECT_FALSE(p.parse("2023-02-29").has_value());
+    EXPECT_FALSE(p.parse("2024-13-01").has_value());
+    EXPECT_FALSE(p.parse("2024-01-01junk").has_value());
+    EXPECT_TRUE(p.parse("1/2/2024").has_value());
+
+    const auto t = p.parse("1970-01-02T00:00:05Z");
+    ASSERT_TRUE(t.has_value());
+    EXPECT_TRUE(t->has_time);
+    EXPECT_EQ(t->seconds, 86405);
+    EXPECT_FALSE(p.parse("2024-01-01T24:00:00").has_value());
+    EXPECT_EQ(csvqr::format_date_value(86405, true), "1970-01-02T00:00:05");
+    EXPECT_THROW(csvqr::date_format("%Y-%q"), std::invalid_argument);
+
+    // overlapping formats: the earlier one wins whatever the previous cell hit
+    const csvqr::date_parser us_eu({"%m/%d/%Y", "%d/%m/%Y"}, {});
+    std::size_t hint = 0;
+    ASSERT_TRUE(us_eu.parse("13/02/2020", hint).has_value());
+    EXPECT_EQ(hint, 1u);
+    EXPECT_EQ(us_eu.parse("01/02/2020", hint)->days, csvqr::days_from_civil(2020, 1, 2));
+    EXPECT_TRUE(csvqr::date_format("%Y-%m-%d").disjoint_from(csvqr::date_format("%m/%d/%Y")));
+    EXPECT_FALSE(csvqr::date_format("%Y%m%d").disjoint_from(csvqr::date_format("%d%m%Y")));
+
+    csvqr::column_profiler prof(',', '"', true);
+    for (std::string_view rec : {"d,ts,bad", "2024-03-01,2024-03-01 10:00:00,2024-02-30",
+                                 "2023-12-31,2024-03-01,2024-01-01"})
+        prof.add_record(rec);
+    const auto pr = prof.finish();
+    EXPECT_EQ(pr.columns[0].logical_type, "date");
+    EXPECT_EQ(*pr.columns[0].min_text, "2023-12-31");
+    EXPECT_EQ(pr.columns[1].logical_type, "datetime");
+    EXPECT_EQ(*pr.columns[1].max_text, "2024-03-01T10:00:00");
+    EXPECT_EQ(pr.columns[2].logical_type, "string");
+}
+
+TEST(Profiler, KllQuantilesWithinRankErrorAndMergeable) {
+    std::mt19937_64 rng(7);
+    std::uniform_real_distribution<double> dist(0.0, 1000.0);
+    std::vector<double> all;
+    csvqr::kll_sketch whole(200), a(200), b(200);
+    for (int i = 0; i < 200000; ++i) {
+        const double x = dist(rng);
+        all.push_back(x);
+        whole.add(x);
+        (i % 3 ? a : b).add(x);
+    }
+    a.merge(b);
+    std::sort(all.begin(), all.end());
+    EXPECT_EQ(a.count(), whole.count());
+    EXPECT_LT(whole.retained(), 1000u);
+    EXPECT_EQ(whole.quantile(0.0), all.front());
+    EXPECT_EQ(whole.quantile(1.0), all.back());
+    for (const csvqr::kll_sketch* s : {&whole, &a}) {
+        for (double q : {0.01, 0.25, 0.5, 0.95, 0.99}) {
+            const double v = s->quantile(q);
+            const double rank = static_cast<double>(std::lower_bound(all.begin(), all.end(), v) - all.begin()) /
+                                static_cast<double>(all.size());
+            EXPECT_NEAR(rank, q, 0.015) << "q=" << q;
+        }
+    }
+}
+
+TEST(Profiler, SpaceSavingFindsHeavyHittersInFixedMemory) {
+    EXPECT_EQ(csvqr::hash64("abc"), csvqr::hash64(std::string("abc")));
+    EXPECT_NE(csvqr::hash64("abc"), csvqr::hash64("abd"));
+    EXPECT_NE(csvqr::hash64("a long key past sixteen bytes"), csvqr::hash64("a long key past sixteen bytez"));
+
+    // three heavy values buried in 300k distinct ones
+    csvqr::space_saving whole(64), a(64), b(64);
+    std::vector<std::uint64_t> truth(3, 0);
+    for (int i = 0; i < 400000; ++i) {
+        std::string v = (i % 4 == 0) ? "hot" + std::to_string(i % 3) : "cold" + std::to_string(i);
+        if (i % 4 == 0) ++truth[static_cast<std::size_t>(i % 3)];
+        whole.add(v);
+        (i % 2 ? a : b).add(v);
+    }
+    EXPECT_LE(whole.size(), 64u);
+    EXPECT_LT(whole.key_bytes_reserved(), 256u * 1024u);
+    EXPECT_LT(whole.interned_keys(), 64u + 4 * 1024u);
+
+    csvqr::string_interner pool;
+    const std::string k1 = "category", k2 = "category";
+    EXPECT_EQ(pool.intern(k1).data(), pool.intern(k2).data());   // one copy for equal bytes
+    EXPECT_NE(pool.intern("other").data(), pool.intern(k1).data());
+    EXPECT_EQ(pool.size(), 2u);
+    EXPECT_EQ(pool.bytes_used(), 13u);
+    a.merge(b);
+    EXPECT_EQ(a.total(), whole.total());
+    for (const csvqr::space_saving* s : {&whole, &a}) {
+        const auto top = s->top(3);
+        ASSERT_EQ(top.size(), 3u);
+        for (const auto& e : top) {
+            ASSERT_EQ(e.key.substr(0, 3), "hot");
+            const std::uint64_t t = truth[static_cast<std::size_t>(e.key[3] - '0')];
+            EXPECT_GE(e.count, t);
+            EXPECT_LE(e.count - e.error, t);
+        }
+    }
+
+    // ties come out by key, whatever order the values arrived or merged in
+    csvqr::space_saving fwd(8), rev(8), left(8), right(8);
+    for (const char* v : {"d", "b", "a", "c"}) { fwd.add(v); right.add(v); }
+    for (const char* v : {"c", "a", "b", "d"}) rev.add(v);
+    left.merge(right);
+    for (const csvqr::space_saving* s : {&fwd, &rev, &left}) {
+        const auto top = s->top(2);
+        ASSERT_EQ(top.size(), 2u);
+        EXPECT_EQ(top[0].key, "a");
+        EXPECT_EQ(top[1].key, "b");
+    }
+}
+
+TEST(Profiler, HllDistinctCountsExactThenWithinErrorAndMergeable) {
+    csvqr::hll_sketch small(12);
+    for (int rep = 0; rep < 3; ++rep)
+        for (int i = 0; i < 50; ++i) small.add_hash(csvqr::hash64(std::to_string(i)));
+    EXPECT_TRUE(small.is_exact());
+    EXPECT_EQ(small.estimate(), 50u);
+
+    // through the sparse stage into dense registers; merge of a split = whole
+    for (std::uint64_t n : {200u, 3000u, 200000u}) {
+        csvqr::hll_sketch whole(12), a(12), b(12);
+        for (std::uint64_t i = 0; i < n; ++i) {
+            const std::uint64_t h = csvqr::hash64("v" + std::to_string(i));
+            whole.add_hash(h);
+            whole.add_hash(h);
+            (i % 3 ? a : b).add_hash(h);
+        }
+        a.merge(b);
+        EXPECT_EQ(a.estimate(), whole.estimate()) << n;
+        EXPECT_NEAR(static_cast<double>(whole.estimate()), static_cast<double>(n), 0.05 * static_cast<double>(n)) << n;
+        EXPECT_LE(whole.bytes(), 4096u);
+    }
+    csvqr::hll_sketch other(10);
+    EXPECT_THROW(small.merge(other), std::invalid_argument);
+}
+
+TEST(Profiler, ParallelProfileMatchesSequential) {
+    // quoted terminators and delimiters, CRLF, short rows, a column that only
+    // appears mid-file, and a column that turns from int to string late
+    std::string csv = "id,price,note,day\r\n";
+    for (int i = 0; i < 3000; ++i) {
+        csv += std::to_string(i) + "," + (i % 11 == 0 ? "" : std::to_string(i % 97) + ".25") + ",";
+        csv += (i % 5 == 0) ? "\"multi\nline, \"\"q\"\"\"" : "w" + std::to_string(i % 13);
+        if (i % 17 != 0) csv += "," + std::string(i == 2900 ? "soon" : "2024-01-0") + (i == 2900 ? "" : std::to_string(1 + i % 9));
+        if (i == 1500) csv += ",7,8";
+        csv += (i % 2) ? "\n" : "\r\n";
+    }
+    csv += "3000,1.5,last,2024-02-01";   // no trailing newline
+
+    csvqr::column_profiler seq(',', '"', true);
+    csvqr::record_splitter split('"');
+    auto on_rec = [&](std::string_view r) { seq.add_record(r); };
+    seq.begin_chunk(csv);
+    split.feed(csv, on_rec);
+    split.finish(on_rec);
+    const auto ref = seq.finish();
+    ASSERT_EQ(ref.rows, 3001u);
+    ASSERT_EQ(ref.columns.size(), 6u);
+    EXPECT_EQ(ref.columns[3].logical_type, "string");
+    EXPECT_EQ(ref.columns[5].null_count, 1500u);   // padded after row 1500
+
+    for (int threads : {2, 3, 7, 16}) {
+        const auto got = csvqr::profile_parallel(csv, ',', '"', true, {}, threads, /*min_bytes_per_thread*/ 1);
+        EXPECT_EQ(got.records, 3002u) << threads;
+        const auto& pr = got.profile;
+        ASSERT_EQ(pr.rows, ref.rows) << threads;
+        ASSERT_EQ(pr.columns.size(), ref.columns.size()) << threads;
+        for (std::size_t c = 0; c < ref.columns.size(); ++c) {
+            const auto& a = pr.columns[c];
+            const auto& b = ref.columns[c];
+            EXPECT_EQ(a.name, b.name);
+            EXPECT_EQ(a.logical_type, b.logical_type) << c;
+            EXPECT_EQ(a.null_count, b.null_count) << c;
+            EXPECT_EQ(a.non_null_count, b.non_null_count) << c;
+            EXPECT_EQ(a.min_int, b.min_int) << c;
+            EXPECT_EQ(a.max_int, b.max_int) << c;
+            EXPECT_EQ(a.min_text, b.min_text) << c;
+            EXPECT_EQ(a.cardinality, b.cardinality) << c;   // HLL merge is exact
+            if (b.mean) { EXPECT_NEAR(*a.mean, *b.mean, 1e-9) << c; }
+            if (b.stddev) { EXPECT_NEAR(*a.stddev, *b.stddev, 1e-9) << c; }
+        }
+        ASSERT_FALSE(pr.columns[2].topk.empty());
+        EXPECT_EQ(pr.columns[2].topk[0].value, "multi\nline, \"q\"");
+        EXPECT_EQ(pr.columns[2].topk[0].count, 600u);
+    }
+
+    // inputs shorter than the thread count: cuts at offset 0 keep the header
+    // with the first non-empty range, and no input has no columns
+    for (std::string_view tiny : {"2.5", "x\n2.5\n", ""}) {
+        const auto one = csvqr::profile_parallel(tiny, ',', '"', true, {}, 1, 1).profile;
+        const auto many = csvqr::profile_parallel(tiny, csvqr::scan_speculative(tiny, ',', '"', 8),
+                                                  ',', '"', true).profile;
+        EXPECT_EQ(many.rows, one.rows) << tiny;
+        EXPECT_EQ(many.columns.size(), one.columns.size()) << tiny;
+    }
+}
+
+TEST(Profiler, ColumnProjectionReportsSelectedColumnsOnly) {
+    std::string csv = "id,note,price,day\n";
+    for (int i = 0; i < 2000; ++i) {
+        csv += std::to_string(i) + ",\"a,\"\"b\n" + std::to_string(i % 7) + "\"," + std::to_string(i % 50) + ".5";
+        if (i % 9 != 0) csv += ",2024-03-0" + std::to_string(1 + i % 9);
+        if (i == 1200) csv += ",x,y";
+        csv += "\n";
+    }
+    auto run = [&](csvqr::profile_options popt) {
+        csvqr::column_profiler prof(',', '"', true, std::move(popt));
+        csvqr::record_splitter split('"');
+        auto on_rec = [&](std::string_view r) { prof.add_record(r); };
+        prof.begin_chunk(csv);
+        split.feed(csv, on_rec);
+        split.finish(on_rec);
+        return prof.finish();
+    };
+    const auto full = run({});
+    ASSERT_EQ(full.columns.size(), 6u);
+
+    csvqr::profile_options inc;
+    inc.include_columns = {"day", "id", "nope"};
+    csvqr::profile_options exc;
+    exc.exclude_columns = {"note", "col5"};
+    const auto a = run(inc);
+    const auto b = run(exc);
+    const auto c = csvqr::profile_parallel(csv, ',', '"', true, exc, 4, 1).profile;
+    const std::vector<std::size_t> want_a = {0, 3}, want_b = {0, 2, 3, 5};
+    ASSERT_EQ(a.columns.size(), want_a.size());
+    ASSERT_EQ(b.columns.size(), want_b.size());
+    ASSERT_EQ(c.columns.size(), want_b.size());
+    auto same = [&](const csvqr::ColumnSummary& x, std::size_t src) {
+        const auto& y = full.columns[src];
+        EXPECT_EQ(x.name, y.name);
+        EXPECT_EQ(x.logical_type, y.logical_type) << y.name;
+        EXPECT_EQ(x.null_count, y.null_count) << y.name;
+        EXPECT_EQ(x.non_null_count, y.non_null_count) << y.name;
+        EXPECT_EQ(x.cardinality, y.cardinality) << y.name;
+    };
+    for (std::size_t i = 0; i < want_a.size(); ++i) same(a.columns[i], want_a[i]);
+    for (std::size_t i = 0; i < want_b.size(); ++i) { same(b.columns[i], want_b[i]); same(c.columns[i], want_b[i]); }
+    EXPECT_EQ(a.rows, full.rows);
+}
+
+TEST(Profiler, TypeLatticeAndForcedTypes) {
+    using namespace csvqr::type_bits;
+    EXPECT_EQ(csvqr::rule_out(all, float64), boolean | date | datetime);
+    EXPECT_EQ(csvqr::rule_out(all, datetime), boolean | int64 | float64);
+    EXPECT_FALSE(csvqr::forced_type_bits("decimal"));
+
+    const std::string csv =
+        "txt,amt,day,code,flag\n"
+        "abc,10,2024-01-02 10:00:00,7,yes\n"
+        "1,x,2024-01-05,8,no\n"
+        "2.5,-3,bad,9,maybe\n"
+        ",4,,,\n";
+    csvqr::profile_options popt;
+    popt.forced_types = {{"amt", "int64"}, {"day", "date"}, {"code", "string"}, {"flag", "bool"}};
+    csvqr::column_profiler prof(',', '"', true, popt);
+    csvqr::record_splitter split('"');
+    auto on_rec = [&](std::string_view r) { prof.add_record(r); };
+    split.feed(csv, on_rec);
+    split.finish(on_rec);
+    const auto pr = prof.finish();
+    ASSERT_EQ(pr.columns.size(), 5u);
+    EXPECT_EQ(pr.columns[0].logical_type, "string");
+    EXPECT_EQ(pr.columns[1].logical_type, "int");           // "x" is left out of the stats
+    EXPECT_EQ(pr.columns[1].min_int, -3);
+    EXPECT_EQ(pr.columns[1].max_int, 10);
+    EXPECT_EQ(pr.columns[1].non_null_count, 4u);
+    EXPECT_EQ(pr.columns[2].logical_type, "date");          // the datetime value is kept as a date
+    EXPECT_EQ(pr.columns[2].min_text, "2024-01-02");
+    EXPECT_EQ(pr.columns[2].max_text, "2024-01-05");
+    EXPECT_EQ(pr.columns[3].logical_type, "string");
+    EXPECT_FALSE(pr.columns[3].mean);
+    EXPECT_EQ(pr.columns[4].logical_type, "bool");
+
+    popt.forced_types = {{"amt", "decimal"}};
+    csvqr::column_profiler bad(',', '"', true, popt);
+    EXPECT_THROW(bad.add_record("txt,amt"), std::invalid_argument);
+}
+
+TEST(Profiler, VerdictMemoIsExactAndTurnsItselfOff) {
+    csvqr::verdict_cache memo;
+    csvqr::cell_verdict v;
+    v.is_bool = true;
+    EXPECT_EQ(memo.find("yes", 7), nullptr);
+    memo.store("yes", 7, v);
+    ASSERT_NE(memo.find("yes", 7), nullptr);
+    EXPECT_TRUE(memo.find("yes", 7)->is_bool);
+    EXPECT_EQ(memo.find("yeS", 7), nullptr);                 // same hash, other bytes
+    const std::string long_key(csvqr::verdict_cache::max_key + 1, 'x');
+    memo.store(long_key, 9, v);
+    EXPECT_EQ(memo.find(long_key, 9), nullptr);
+    EXPECT_EQ(memo.hits(), 2u);
+    for (std::uint64_t i = 0; i < 2 * csvqr::verdict_cache::window; ++i) {
+        const std::string k = std::to_string(i);
+        if (!memo.find(k, csvqr::hash64(k))) memo.store(k, csvqr::hash64(k), v);
+    }
+    EXPECT_FALSE(memo.enabled());
+
+    // a repetitive column: same verdicts, numbers and top-k as without the memo
+    std::string csv = "code,amount,flag\n";
+    for (int i = 0; i < 20000; ++i)
+        csv += std::to_string(200 + i % 7 * 100) + "," + std::to_string(i % 5) + ".5," + (i % 3 ? "true" : "NA") + "\n";
+    csvqr::column_profiler prof(',', '"', true);
+    csvqr::record_splitter split('"');
+    auto on_rec = [&](std::string_view r) { prof.add_record(r); };
+    split.feed(csv, on_rec);
+    split.finish(on_rec);
+    const auto pr = prof.finish();
+    EXPECT_GT(pr.memo_hits * 100, pr.memo_lookups * 99);
+    EXPECT_EQ(pr.columns[0].logical_type, "int");
+    EXPECT_EQ(pr.columns[0].min_int, 200);
+    EXPECT_EQ(pr.columns[0].max_int, 800);
+    EXPECT_EQ(pr.columns[0].cardinality, 7u);
+    EXPECT_EQ(pr.columns[1].logical_type, "float");
+    EXPECT_NEAR(*pr.columns[1].mean, 2.5, 1e-9);
+    EXPECT_EQ(pr.columns[2].logical_type, "bool");
+    EXPECT_EQ(pr.columns[2].null_count, 6667u);
+    ASSERT_EQ(pr.columns[0].topk.size(), 7u);
+    EXPECT_EQ(pr.columns[0].topk[0].count, 2858u);
+    EXPECT_EQ(pr.columns[0].topk[0].error, 0u);
+}
+
+TEST(Profiler, StreamHistogramIsOnePassAndSplitInvariant) {
+    std::mt19937_64 rng(3);
+    std::normal_distribution<double> dist(50.0, 20.0);
+    csvqr::stream_histogram whole(16), parts[3] = {csvqr::stream_histogram(16), csvqr::stream_histogram(16),
+                                                   csvqr::stream_histogram(16)};
+    double mn = 1e300, mx = -1e300;
+    for (int i = 0; i < 50000; ++i) {
+        const double x = dist(rng);
+        mn = std::min(mn, x);
+        mx = std::max(mx, x);
+        whole.add(x);
+        parts[i % 3].add(x);
+    }
+    whole.add(std::numeric_limits<double>::quiet_NaN());   // skipped
+    parts[2].merge(parts[1]);
+    parts[0].merge(parts[2]);
+
+    const auto h = whole.to_histogram();
+    const auto g = parts[0].to_histogram();
+    EXPECT_LE(h.bins, 16);
+    EXPECT_GE(h.bins, 8);
+    EXPECT_EQ(h.edges, g.edges);
+    EXPECT_EQ(h.counts, g.counts);
+    ASSERT_EQ(h.edges.size(), static_cast<std::size_t>(h.bins) + 1);
+    EXPECT_LE(h.edges.front(), mn);
+    EXPECT_GT(h.edges.back(), mx);
+    std::size_t total = 0;
+    for (auto c : h.counts) total += c;
+    EXPECT_EQ(total, 50000u);
+
+    csvqr::stream_histogram one(16);
+    for (int i = 0; i < 4; ++i) one.add(7.0);
+    const auto p = one.to_histogram();
+    ASSERT_EQ(p.bins, 1);
+    EXPECT_EQ(p.counts[0], 4u);
+}
+
+TEST(Profiler, NullMatcherIsCaseInsensitiveOnTrimmedCells) {
+    const csvqr::null_matcher m({"", " NA ", "N/A", "null", "-"});
+    for (std::string_view t : {"", "NA", "na", "n/a", "NULL", "Null", "-"}) EXPECT_TRUE(m(t)) << t;
+    for (std::string_view t : {"N", "NAN", "nul", "nulls", "0", "--", "N/B", "alpha"}) EXPECT_FALSE(m(t)) << t;
+
+    const csvqr::null_matcher strict({"NA"}, /*case_insensitive*/ false);
+    EXPECT_TRUE(strict("NA"));
+    EXPECT_FALSE(strict("na"));
+    EXPECT_FALSE(strict(""));
+
+    // wired through profile_options
+    csvqr::profile_options popt;
+    popt.null_tokens = {"?"};
+    csvqr::column_profiler prof(',', '"', true, popt);
+    for (std::string_view rec : {"a", "1", " ? ", "NA", ""}) prof.add_record(rec);
+    const auto pr = prof.finish();
+    EXPECT_EQ(pr.columns[0].null_count, 1u);
+    EXPECT_EQ(pr.columns[0].logical_type, "string");
+}
+
+TEST(Profiler, SampledProfileEstimatesRowsAndNulls) {
+    // multi-line quoted fields make a random offset land inside quotes often
+    std::string csv = "id,note,score\n";
+    std::mt19937 rng(7);
+    const std::uint64_t rows = 200000;
+    std::uint64_t null_scores = 0;
+    for (std::uint64_t i = 0; i < rows; ++i) {
+        csv += std::to_string(i);
+        csv += (i % 3 == 0) ? ",\"multi\nline, \"\"quoted\"\"\"," : ",plain,";
+        if (rng() % 10 == 0) { csv += "NA"; ++null_scores; }
+        else csv += std::to_string(rng() % 1000) + ".5";
+        csv += (i % 2) ? "\r\n" : "\n";
+    }
+
+    csvqr::sample_options so;
+    so.fraction = 0.05;
+    so.max_rows = 0;
+    so.block_bytes = 16 * 1024;
+    auto sr = csvqr::profile_sampled(csv, ',', '"', true, {}, so);
+    ASSERT_TRUE(sr.has_value());
+    const auto& pr = sr->profile;
+    ASSERT_TRUE(pr.sample.has_value());
+    EXPECT_LT(pr.sample->rows, rows / 10);
+    EXPECT_LE(pr.sample->rows_lo, rows);
+    EXPECT_GE(pr.sample->rows_hi, rows);
+    EXPECT_NEAR(static_cast<double>(pr.rows), static_cast<double>(rows), rows * 0.02);
+
+    ASSERT_EQ(pr.columns.size(), 3u);
+    EXPECT_EQ(pr.columns[0].logical_type, "int");     // no record was cut mid-field
+    EXPECT_EQ(pr.columns[2].logical_type, "float");
+    EXPECT_EQ(pr.columns[0].null_count, 0u);
+    const auto& score = pr.columns[2];
+    ASSERT_TRUE(score.null_count_ci.has_value());
+    EXPECT_LE(score.null_count_ci->first, null_scores);
+    EXPECT_GE(score.null_count_ci->second, null_scores);
+    EXPECT_EQ(score.null_count + score.non_null_count, pr.rows);
+
+    // the row cap stops early; small inputs and fraction 1 are not sampled
+    so.max_rows = 1000;
+    auto capped = csvqr::profile_sampled(csv, ',', '"', true, {}, so);
+    ASSERT_TRUE(capped.has_value());
+    EXPECT_EQ(capped->profile.sample->rows, 1000u);
+    EXPECT_FALSE(csvqr::profile_sampled("a,b\n1,2\n", ',', '"', true, {}, so).has_value());
+    so.fraction = 1.0;
+    EXPECT_FALSE(csvqr::profile_sampled(csv, ',', '"', true, {}, so).has_value());
+}
+
+TEST(Profiler, SavedStateResumesAndCachedScanMatches) {
+    std::string csv = "id,score,day,tag\n";
+    std::mt19937 rng(11);
+    std::vector<std::string> recs;
+    for (int i = 0; i < 20000; ++i) {
+        recs.push_back(std::to_string(i) + "," + std::to_string(rng() % 5000) + ".25,2024-01-" +
+                       std::to_string(10 + i % 20) + ",t" + std::to_string(rng() % 300));
+        csv += recs.back() + "\n";
+    }
+
+    // save halfway, load into a fresh profiler, feed the rest: same as one pass
+    csvqr::column_profiler whole(',', '"', true), first(',', '"', true), rest(',', '"', true);
+    whole.add_record("id,score,day,tag");
+    first.add_record("id,score,day,tag");
+    for (std::size_t i = 0; i < recs.size(); ++i) {
+        whole.add_record(recs[i]);
+        if (i < recs.size() / 2) first.add_record(recs[i]);
+    }
+    csvqr::byte_writer w;
+    first.save(w);
+    csvqr::byte_reader r(w.bytes());
+    rest.load(r);
+    EXPECT_TRUE(r.at_end());
+    for (std::size_t i = recs.size() / 2; i < recs.size(); ++i) rest.add_record(recs[i]);
+    const auto a = whole.finish(), b = rest.finish();
+    ASSERT_EQ(a.rows, b.rows);
+    ASSERT_EQ(a.columns.size(), b.columns.size());
+    for (std::size_t c = 0; c < a.columns.size(); ++c) {
+        EXPECT_EQ(a.columns[c].logical_type, b.columns[c].logical_type);
+        EXPECT_EQ(a.columns[c].null_count, b.columns[c].null_count);
+        EXPECT_EQ(a.columns[c].cardinality, b.columns[c].cardinality);
+        EXPECT_EQ(a.columns[c].min, b.columns[c].min);
+        EXPECT_EQ(a.columns[c].max_text, b.columns[c].max_text);
+        EXPECT_EQ(a.columns[c].quantiles, b.columns[c].quantiles);
+        EXPECT_EQ(a.columns[c].hist.has_value(), b.columns[c].hist.has_value());
+        ASSERT_FALSE(b.columns[c].topk.empty());
+    }
+    EXPECT_EQ(a.columns[3].topk[0].value, b.columns[3].topk[0].value);
+    EXPECT_THROW({ csvqr::byte_reader t(std::string_view(w.bytes()).substr(0, w.bytes().size() / 2));
+                   csvqr::column_profiler(',', '"', true).load(t); }, std::runtime_error);
+
+    // fused_scan: a miss saves the state, the next run of the same file loads it
+    const auto dir = std::filesystem::temp_directory_path() / "csvqr_cache_test";
+    std::filesystem::remove_all(dir);
+    const auto path = dir / "in.csv";
+    std::filesystem::create_directories(dir);
+    { std::ofstream(path, std::ios::binary) << csv; }
+    csvqr::scan_options opt;
+    opt.cache_dir = dir / ".cache";
+    auto run = [&](csvqr::scan_options o) {
+        csvqr::fused_scan scan(path, o);
+        while (scan.next()) {}
+        auto pr = scan.finish();
+        return std::make_tuple(scan.cache_hit_pct(), scan.counts().rows, pr);
+    };
+    const auto [miss_pct, miss_rows, miss] = run(opt);
+    const auto [hit_pct, hit_rows, hit] = run(opt);
+    EXPECT_EQ(miss_pct, 0.0);
+    EXPECT_EQ(hit_pct, 100.0);
+    EXPECT_EQ(hit_rows, miss_rows);
+    ASSERT_EQ(hit.columns.size(), miss.columns.size());
+    for (std::size_t c = 0; c < hit.columns.size(); ++c) {
+        EXPECT_EQ(hit.columns[c].logical_type, miss.columns[c].logical_type);
+        EXPECT_EQ(hit.columns[c].quantiles, miss.columns[c].quantiles);
+        EXPECT_EQ(hit.columns[c].cardinality, miss.columns[c].cardinality);
+    }
+
+    // appended rows: only the tail is scanned, the result matches a full scan
+    for (int i = 0; i < 5000; ++i)
+        csv += std::to_string(20000 + i) + "," + std::to_string(rng() % 5000) + ".5,2024-02-01,t" +
+               std::to_string(rng() % 300) + "\n";
+    { std::ofstream(path, std::ios::binary) << csv; }
+    const auto [grow_pct, grow_rows, grown] = run(opt);
+    EXPECT_GT(*grow_pct, 70.0);
+    EXPECT_LT(*grow_pct, 100.0);
+    csvqr::scan_options fresh;
+    const auto [none_pct, full_rows, full] = run(fresh);
+    EXPECT_EQ(grow_rows, 25000u);
+    EXPECT_EQ(grow_rows, full_rows);
+    ASSERT_EQ(grown.columns.size(), full.columns.size());
+    for (std::size_t c = 0; c < full.columns.size(); ++c) {
+        EXPECT_EQ(grown.columns[c].logical_type, full.columns[c].logical_type);
+        EXPECT_EQ(grown.columns[c].null_count, full.columns[c].null_count);
+        EXPECT_EQ(grown.columns[c].cardinality, full.columns[c].cardinality);
+        EXPECT_EQ(grown.columns[c].max_text, full.columns[c].max_text);
+    }
+    EXPECT_EQ(std::get<0>(run(opt)), 100.0);
+
+    // other options or other bytes are a miss
+    csvqr::scan_options other = opt;
+    other.profile.topk = 5;
+    EXPECT_EQ(std::get<0>(run(other)), 0.0);
+    EXPECT_EQ(std::get<0>(run(opt)), 0.0);   // one entry per input: replaced by `other`
+    csv[csv.size() - 2] = 'x';   // same size, new content
+    { std::ofstream(path, std::ios::binary) << csv; }
+    EXPECT_EQ(std::get<0>(run(opt)), 0.0);
+    opt.cache_dir.clear();
+    EXPECT_FALSE(std::get<0>(run(opt)).has_value());
+    std::filesystem::remove_all(dir);
+}
+
+TEST(Profiler, ColumnarSnapshotProfilesLikeItsCsv) {
+    // typed columns, a decimal column, nulls, a late int column that demotes
+    // (leading zeros), mixed date/datetime text and rows wider than the header
+    std::string csv = "id,price,flag,day,name,code\n";
+    std::mt19937 rng(5);
+    for (int i = 0; i < 70000; ++i) {
+        const auto cents = static_cast<unsigned>(rng() % 90000);
+        const std::string price = std::to_string(cents / 100) + (cents % 100 < 10 ? ".0" : ".") + std::to_string(cents % 100);
+        csv += std::to_string(i) + "," + (i % 97 == 0 ? "NA" : price) + "," +
+               (i % 2 ? "true" : "false") + "," + (i % 1000 == 7 ? "2024-03-01 08:30:00" : "2024-02-0" + std::to_string(1 + i % 9)) +
+               ",n" + std::to_string(rng() % 50) + "," + (i == 68000 ? "007" : std::to_string(rng() % 1000));
+        if (i % 5000 == 4999) csv += ",extra";
+        csv += "\n";
+    }
+    const auto dir = std::filesystem::temp_directory_path() / "csvqr_snapshot_test";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const auto path = dir / "in.csv", snap = dir / "in.csvqs";
+    { std::ofstream(path, std::ios::binary) << csv; }
+
+    auto run = [&](const std::filesystem::path& in, csvqr::scan_options o) {
+        csvqr::fused_scan scan(in, o);
+        while (scan.next()) {}
+        auto pr = scan.finish();
+        return std::make_tuple(scan.from_snapshot(), scan.counts().rows, scan.counts().columns, pr);
+    };
+    csvqr::scan_options opt;
+    const auto [csv_is_snap, rows, cols, from_csv] = run(path, opt);
+    EXPECT_FALSE(csv_is_snap);
+    ASSERT_TRUE(csvqr::write_snapshot(path, snap, ',', '"', true, opt.profile, from_csv, CsvCounts{rows, cols}));
+    EXPECT_TRUE(csvqr::is_snapshot_file(snap));
+    EXPECT_FALSE(csvqr::is_snapshot_file(path));
+
+    for (int threads : {1, 3}) {
+        opt.threads = threads;
+        const auto [is_snap, snap_rows, snap_cols, from_snap] = run(snap, opt);
+        EXPECT_TRUE(is_snap);
+        EXPECT_EQ(snap_rows, rows);
+        EXPECT_EQ(snap_cols, cols);
+        ASSERT_EQ(from_snap.columns.size(), from_csv.columns.size());
+        for (std::size_t c = 0; c < from_csv.columns.size(); ++c) {
+            const auto& a = from_csv.columns[c];
+            const auto& b = from_snap.columns[c];
+            EXPECT_EQ(a.name, b.name);
+            EXPECT_EQ(a.logical_type, b.logical_type) << a.name;
+            EXPECT_EQ(a.null_count, b.null_count) << a.name;
+            EXPECT_EQ(a.non_null_count, b.non_null_count) << a.name;
+            EXPECT_EQ(a.cardinality, b.cardinality) << a.name;
+            EXPECT_EQ(a.min, b.min) << a.name;
+            EXPECT_EQ(a.mean, b.mean) << a.name;
+            EXPECT_EQ(a.quantiles, b.quantiles) << a.name;
+            EXPECT_EQ(a.max_int, b.max_int) << a.name;
+            EXPECT_EQ(a.min_text, b.min_text) << a.name;
+            EXPECT_EQ(a.max_text, b.max_text) << a.name;
+            ASSERT_EQ(a.topk.empty(), b.topk.empty()) << a.name;
+            if (!a.topk.empty() && *a.cardinality < 80) {   // fewer values than counters: exact
+                EXPECT_EQ(a.topk[0].count, b.topk[0].count) << a.name;
+            }
+        }
+    }
+    EXPECT_EQ(from_csv.columns[1].logical_type, "float");
+    EXPECT_EQ(from_csv.columns[3].logical_type, "datetime");
+    EXPECT_EQ(from_csv.columns[6].null_count, 70000u - 4999u - 14u);
+
+    // the reading run's projection and forced types apply
+    opt.threads = 1;
+    opt.profile.exclude_columns = {"name"};
+    opt.profile.forced_types = {{"flag", "string"}, {"code", "float"}};
+    const auto [c_snap, c_rows, c_cols, csv_forced] = run(path, opt);
+    const auto [s_snap, s_rows, s_cols, snap_forced] = run(snap, opt);
+    ASSERT_EQ(snap_forced.columns.size(), 6u);
+    ASSERT_EQ(csv_forced.columns.size(), 6u);
+    for (std::size_t c = 0; c < 6; ++c) {
+        EXPECT_EQ(csv_forced.columns[c].name, snap_forced.columns[c].name);
+        EXPECT_EQ(csv_forced.columns[c].logical_type, snap_forced.columns[c].logical_type);
+        EXPECT_EQ(csv_forced.columns[c].cardinality, snap_forced.columns[c].cardinality);
+        EXPECT_EQ(csv_forced.columns[c].mean, snap_forced.columns[c].mean);
+    }
+
+    // truncated or foreign bytes are rejected
+    std::string bytes;
+    {
+        std::ifstream f(snap, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    }
+    EXPECT_THROW(csvqr::snapshot_file(std::string_view(bytes).substr(0, bytes.size() - 1)), std::runtime_error);
+    EXPECT_THROW(csvqr::snapshot_file(std::string_view(csv)), std::runtime_error);
+    std::filesystem::remove_all(dir);
+}
+
+TEST(Profiler, SpanHistogramQuantilesWithinBucketBounds) {
+    span_histogram h;
+    EXPECT_EQ(h.quantile_ms(0.5), 0.0);
+    h.add_ns(1'234'567);
+    EXPECT_DOUBLE_EQ(h.quantile_ms(0.5), 1.234567);   // one span: exact
+    EXPECT_DOUBLE_EQ(h.max_ms(), 1.234567);
+
+    span_histogram a, b;
+    std::uint64_t total = 0;
+    for (std::uint64_t i = 1; i <= 10000; ++i) {
+        const std::uint64_t ns = i * 997;
+        (i % 2 ? a : b).add_ns(ns);
+        total += ns;
+    }
+    a.merge(b);
+    EXPECT_EQ(a.count(), 10000u);
+    EXPECT_EQ(a.total_ns(), total);
+    EXPECT_DOUBLE_EQ(a.max_ms(), 10000 * 997 / 1e6);
+    for (double q : {0.5, 0.95, 0.99}) {
+        const double truth = q * 10000 * 997 / 1e6;
+        EXPECT_NEAR(a.quantile_ms(q), truth, truth / 16) << q;
+    }
+}
+
+TEST(Profiler, ParallelMergeKeepsWidenedProjectionForResume) {
+    csvqr::profile_options popt;
+    popt.exclude_columns = {"col5"};
+    std::string data = "a,b,c\n";
+    for (int i = 0; i < 50; ++i) data += std::to_string(i) + ",2,3\n";
+    const std::size_t cut = data.size();
+    for (int i = 0; i < 50; ++i) data += "7,8,9,10," + std::to_string(90 + i) + "\n";
+
+    csvqr::column_profiler par(',', '"', true, popt);
+    csvqr::profile_parallel_into(par, data, std::vector<std::size_t>{0, cut, data.size()}, ',', '"', true, popt);
+    csvqr::byte_writer w;
+    par.save(w);
+    csvqr::column_profiler resumed(',', '"', true, popt);
+    csvqr::byte_reader r(w.bytes());
+    resumed.load(r);
+    resumed.add_record("14,15,16,17,88");
+
+    csvqr::column_profiler seq(',', '"', true, popt);
+    csvqr::record_splitter split('"');
+    auto on_record = [&](std::string_view rec){ seq.add_record(rec); };
+    split.feed(data, on_record);
+    split.finish(on_record);
+    seq.add_record("14,15,16,17,88");
+
+    const auto a = seq.finish(), b = resumed.finish();
+    ASSERT_EQ(a.columns.size(), 4u);
+    ASSERT_EQ(b.columns.size(), a.columns.size());
+    for (std::size_t c = 0; c < a.columns.size(); ++c) {
+        EXPECT_EQ(b.columns[c].name, a.columns[c].name);
+        EXPECT_EQ(b.columns[c].null_count, a.columns[c].null_count);
+        EXPECT_EQ(b.columns[c].max_text, a.columns[c].max_text);
+    }
+}